@@ -175,6 +175,9 @@ static char *print_double(cJSON *item)
             sprintf(str, "%lf", d);
         else
             sprintf(str, "%f", d);
+        /* Fall back to full precision if the fixed notation loses digits */
+        if (strtod(str, NULL) != d)
+            sprintf(str, "%1.17g", d);
     }
     return str;
 }
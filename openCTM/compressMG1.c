@@ -35,19 +35,6 @@
 #endif
 
 
-//-----------------------------------------------------------------------------
-// _compareTriangle() - Comparator for the triangle sorting.
-//-----------------------------------------------------------------------------
-static int _compareTriangle(const void * elem1, const void * elem2)
-{
-  CTMuint * tri1 = (CTMuint *) elem1;
-  CTMuint * tri2 = (CTMuint *) elem2;
-  if(tri1[0] != tri2[0])
-    return tri1[0] - tri2[0];
-  else
-    return tri1[1] - tri2[1];
-}
-
 //-----------------------------------------------------------------------------
 // _ctmReArrangeTriangles() - Re-arrange all triangles for optimal
 // compression.
@@ -78,7 +65,7 @@ static void _ctmReArrangeTriangles(_CTMcontext * self, CTMuint * aIndices)
   }
 
   // Step 2: Sort the triangles based on the first triangle index
-  qsort((void *) aIndices, self->mTriangleCount, sizeof(CTMuint) * 3, _compareTriangle);
+  _ctmSortTriangles(aIndices, self->mTriangleCount);
 }
 
 //-----------------------------------------------------------------------------
@@ -144,17 +131,28 @@ int _ctmCompressMesh_MG1(_CTMcontext * self)
 {
   CTMuint * indices;
   _CTMfloatmap * map;
-  CTMuint i;
+  _CTMpackedstream * streams;
+  CTMuint i, streamCount, s;
 
 #ifdef __DEBUG_
   printf("COMPRESSION METHOD: MG1\n");
 #endif
 
+  // One packed stream each for indices, vertices, normals and all maps
+  streamCount = 2 + (self->mNormals ? 1 : 0) + self->mUVMapCount + self->mAttribMapCount;
+  streams = (_CTMpackedstream *) malloc(sizeof(_CTMpackedstream) * streamCount);
+  if(!streams)
+  {
+    self->mError = CTM_OUT_OF_MEMORY;
+    return CTM_FALSE;
+  }
+
   // Perpare (sort) indices
   indices = (CTMuint *) malloc(sizeof(CTMuint) * self->mTriangleCount * 3);
   if(!indices)
   {
     self->mError = CTM_OUT_OF_MEMORY;
+    free((void *) streams);
     return CTM_FALSE;
   }
   for(i = 0; i < self->mTriangleCount * 3; ++ i)
@@ -164,30 +162,39 @@ int _ctmCompressMesh_MG1(_CTMcontext * self)
   // Calculate index deltas (entropy-reduction)
   _ctmMakeIndexDeltas(self, indices);
 
+  // Set up the streams, in file order
+  s = 0;
+  _ctmStreamSetPacked(&streams[s ++], (void *) indices, self->mTriangleCount, 3, CTM_FALSE, CTM_TRUE);
+  _ctmStreamSetPacked(&streams[s ++], (void *) self->mVertices, self->mVertexCount * 3, 1, CTM_FALSE, CTM_FALSE);
+  if(self->mNormals)
+    _ctmStreamSetPacked(&streams[s ++], (void *) self->mNormals, self->mVertexCount, 3, CTM_FALSE, CTM_FALSE);
+  for(map = self->mUVMaps; map; map = map->mNext)
+    _ctmStreamSetPacked(&streams[s ++], (void *) map->mValues, self->mVertexCount, 2, CTM_FALSE, CTM_FALSE);
+  for(map = self->mAttribMaps; map; map = map->mNext)
+    _ctmStreamSetPacked(&streams[s ++], (void *) map->mValues, self->mVertexCount, 4, CTM_FALSE, CTM_FALSE);
+
+  // Compress all streams (the streams are independent of each other)
+  if(!_ctmStreamPackAll(self, streams, streamCount))
+  {
+    _ctmStreamFreePacked(streams, streamCount);
+    free((void *) streams);
+    return CTM_FALSE;
+  }
+
   // Write triangle indices
 #ifdef __DEBUG_
   printf("Inidices: ");
 #endif
+  s = 0;
   _ctmStreamWrite(self, (void *) "INDX", 4);
-  if(!_ctmStreamWritePackedInts(self, (CTMint *) indices, self->mTriangleCount, 3, CTM_FALSE))
-  {
-    free((void *) indices);
-    return CTM_FALSE;
-  }
-
-  // Free temporary resources
-  free((void *) indices);
+  _ctmStreamWritePackedStream(self, &streams[s ++]);
 
   // Write vertices
 #ifdef __DEBUG_
   printf("Vertices: ");
 #endif
   _ctmStreamWrite(self, (void *) "VERT", 4);
-  if(!_ctmStreamWritePackedFloats(self, self->mVertices, self->mVertexCount * 3, 1))
-  {
-    free((void *) indices);
-    return CTM_FALSE;
-  }
+  _ctmStreamWritePackedStream(self, &streams[s ++]);
 
   // Write normals
   if(self->mNormals)
@@ -196,8 +203,7 @@ int _ctmCompressMesh_MG1(_CTMcontext * self)
     printf("Normals: ");
 #endif
     _ctmStreamWrite(self, (void *) "NORM", 4);
-    if(!_ctmStreamWritePackedFloats(self, self->mNormals, self->mVertexCount, 3))
-      return CTM_FALSE;
+    _ctmStreamWritePackedStream(self, &streams[s ++]);
   }
 
   // Write UV maps
@@ -210,8 +216,7 @@ int _ctmCompressMesh_MG1(_CTMcontext * self)
     _ctmStreamWrite(self, (void *) "TEXC", 4);
     _ctmStreamWriteSTRING(self, map->mName);
     _ctmStreamWriteSTRING(self, map->mFileName);
-    if(!_ctmStreamWritePackedFloats(self, map->mValues, self->mVertexCount, 2))
-      return CTM_FALSE;
+    _ctmStreamWritePackedStream(self, &streams[s ++]);
     map = map->mNext;
   }
 
@@ -224,11 +229,14 @@ int _ctmCompressMesh_MG1(_CTMcontext * self)
 #endif
     _ctmStreamWrite(self, (void *) "ATTR", 4);
     _ctmStreamWriteSTRING(self, map->mName);
-    if(!_ctmStreamWritePackedFloats(self, map->mValues, self->mVertexCount, 4))
-      return CTM_FALSE;
+    _ctmStreamWritePackedStream(self, &streams[s ++]);
     map = map->mNext;
   }
 
+  // Free temporary resources
+  _ctmStreamFreePacked(streams, streamCount);
+  free((void *) streams);
+
   return CTM_TRUE;
 }
 
@@ -59,8 +59,9 @@ typedef struct {
 // _CTMsortvertex - Vertex information.
 //-----------------------------------------------------------------------------
 typedef struct {
-  // Vertex X coordinate (used for sorting).
-  CTMfloat x;
+  // Vertex X coordinate as an order preserving unsigned key (used for
+  // sorting, see _ctmFloatSortKey()).
+  CTMuint mSortX;
 
   // Grid index. This is the index into the 3D space subdivision grid.
   CTMuint mGridIndex;
@@ -172,18 +173,33 @@ static void _ctmGridIdxToPoint(_CTMgrid * aGrid, CTMuint aIdx, CTMfloat * aPoint
 }
 
 //-----------------------------------------------------------------------------
-// _compareVertex() - Comparator for the vertex sorting.
+// _ctmFloatSortKey() - Map a float to an unsigned integer with the same
+// ordering (negative and positive zero map to the same key).
+//-----------------------------------------------------------------------------
+static CTMuint _ctmFloatSortKey(CTMfloat aValue)
+{
+  union {
+    CTMfloat f;
+    CTMuint i;
+  } u;
+  u.f = (aValue == 0.0f) ? 0.0f : aValue;
+  return (u.i & 0x80000000) ? ~u.i : (u.i | 0x80000000);
+}
+
+//-----------------------------------------------------------------------------
+// _compareVertex() - Comparator for the vertex sorting (used when the radix
+// sort can not allocate its temporary buffers).
 //-----------------------------------------------------------------------------
 static int _compareVertex(const void * elem1, const void * elem2)
 {
   _CTMsortvertex * v1 = (_CTMsortvertex *) elem1;
   _CTMsortvertex * v2 = (_CTMsortvertex *) elem2;
   if(v1->mGridIndex != v2->mGridIndex)
-    return v1->mGridIndex - v2->mGridIndex;
-  else if(v1->x < v2->x)
-    return -1;
-  else if(v1->x > v2->x)
-    return 1;
+    return v1->mGridIndex < v2->mGridIndex ? -1 : 1;
+  else if(v1->mSortX != v2->mSortX)
+    return v1->mSortX < v2->mSortX ? -1 : 1;
+  else if(v1->mOriginalIndex != v2->mOriginalIndex)
+    return v1->mOriginalIndex < v2->mOriginalIndex ? -1 : 1;
   else
     return 0;
 }
@@ -195,20 +211,27 @@ static int _compareVertex(const void * elem1, const void * elem2)
 static void _ctmSortVertices(_CTMcontext * self, _CTMsortvertex * aSortVertices,
   _CTMgrid * aGrid)
 {
+  // Sort keys as word offsets into _CTMsortvertex: grid index, then x
+  static const CTMuint keys[2] = { 1, 0 };
   CTMuint i;
 
   // Prepare sort vertex array
   for(i = 0; i < self->mVertexCount; ++ i)
   {
     // Store vertex properties in the sort vertex array
-    aSortVertices[i].x = self->mVertices[i * 3];
+    aSortVertices[i].mSortX = _ctmFloatSortKey(self->mVertices[i * 3]);
     aSortVertices[i].mGridIndex = _ctmPointToGridIdx(aGrid, &self->mVertices[i * 3]);
     aSortVertices[i].mOriginalIndex = i;
   }
 
   // Sort vertices. The elements are first sorted by their grid indices, and
-  // scondly by their x coordinates.
-  qsort((void *) aSortVertices, self->mVertexCount, sizeof(_CTMsortvertex), _compareVertex);
+  // scondly by their x coordinates. Vertices with equal keys are ordered by
+  // their original index: the radix sort is stable and the records start in
+  // that order, and the qsort fallback compares it explicitly, so there are no
+  // ties left to the C library.
+  if(!_ctmRadixSort((CTMuint *) aSortVertices, self->mVertexCount,
+                    sizeof(_CTMsortvertex) / sizeof(CTMuint), keys, 2))
+    qsort((void *) aSortVertices, self->mVertexCount, sizeof(_CTMsortvertex), _compareVertex);
 }
 
 //-----------------------------------------------------------------------------
@@ -239,19 +262,6 @@ static int _ctmReIndexIndices(_CTMcontext * self, _CTMsortvertex * aSortVertices
   return CTM_TRUE;
 }
 
-//-----------------------------------------------------------------------------
-// _compareTriangle() - Comparator for the triangle sorting.
-//-----------------------------------------------------------------------------
-static int _compareTriangle(const void * elem1, const void * elem2)
-{
-  CTMuint * tri1 = (CTMuint *) elem1;
-  CTMuint * tri2 = (CTMuint *) elem2;
-  if(tri1[0] != tri2[0])
-    return tri1[0] - tri2[0];
-  else
-    return tri1[1] - tri2[1];
-}
-
 //-----------------------------------------------------------------------------
 // _ctmReArrangeTriangles() - Re-arrange all triangles for optimal
 // compression.
@@ -282,7 +292,7 @@ static void _ctmReArrangeTriangles(_CTMcontext * self, CTMuint * aIndices)
   }
 
   // Step 2: Sort the triangles based on the first triangle index
-  qsort((void *) aIndices, self->mTriangleCount, sizeof(CTMuint) * 3, _compareTriangle);
+  _ctmSortTriangles(aIndices, self->mTriangleCount);
 }
 
 //-----------------------------------------------------------------------------
@@ -806,37 +816,38 @@ int _ctmCompressMesh_MG2(_CTMcontext * self)
   _CTMgrid grid;
   _CTMsortvertex * sortVertices;
   _CTMfloatmap * map;
+  _CTMpackedstream * streams;
   CTMuint * indices, * deltaIndices, * gridIndices;
   CTMint * intVertices, * intNormals, * intUVCoords, * intAttribs;
   CTMfloat * restoredVertices;
-  CTMuint i;
+  CTMuint i, streamCount, s;
 
 #ifdef __DEBUG_
   printf("COMPRESSION METHOD: MG2\n");
 #endif
 
+  // The streams are prepared first, then compressed together and written in
+  // file order: vertices, grid indices, indices, normals and all maps
+  streamCount = 3 + (self->mNormals ? 1 : 0) + self->mUVMapCount + self->mAttribMapCount;
+  streams = (_CTMpackedstream *) malloc(sizeof(_CTMpackedstream) * streamCount);
+  if(!streams)
+  {
+    self->mError = CTM_OUT_OF_MEMORY;
+    return CTM_FALSE;
+  }
+  for(i = 0; i < streamCount; ++ i)
+    _ctmStreamSetPacked(&streams[i], (void *) 0, 0, 0, CTM_FALSE, CTM_TRUE);
+  s = 0;
+
   // Setup 3D space subdivision grid
   _ctmSetupGrid(self, &grid);
 
-  // Write MG2-specific header information to the stream
-  _ctmStreamWrite(self, (void *) "MG2H", 4);
-  _ctmStreamWriteFLOAT(self, self->mVertexPrecision);
-  _ctmStreamWriteFLOAT(self, self->mNormalPrecision);
-  _ctmStreamWriteFLOAT(self, grid.mMin[0]);
-  _ctmStreamWriteFLOAT(self, grid.mMin[1]);
-  _ctmStreamWriteFLOAT(self, grid.mMin[2]);
-  _ctmStreamWriteFLOAT(self, grid.mMax[0]);
-  _ctmStreamWriteFLOAT(self, grid.mMax[1]);
-  _ctmStreamWriteFLOAT(self, grid.mMax[2]);
-  _ctmStreamWriteUINT(self, grid.mDivision[0]);
-  _ctmStreamWriteUINT(self, grid.mDivision[1]);
-  _ctmStreamWriteUINT(self, grid.mDivision[2]);
-
   // Prepare (sort) vertices
   sortVertices = (_CTMsortvertex *) malloc(sizeof(_CTMsortvertex) * self->mVertexCount);
   if(!sortVertices)
   {
     self->mError = CTM_OUT_OF_MEMORY;
+    free((void *) streams);
     return CTM_FALSE;
   }
   _ctmSortVertices(self, sortVertices, &grid);
@@ -847,68 +858,52 @@ int _ctmCompressMesh_MG2(_CTMcontext * self)
   {
     self->mError = CTM_OUT_OF_MEMORY;
     free((void *) sortVertices);
+    free((void *) streams);
     return CTM_FALSE;
   }
   _ctmMakeVertexDeltas(self, intVertices, sortVertices, &grid);
-
-  // Write vertices
-#ifdef __DEBUG_
-  printf("Vertices: ");
-#endif
-  _ctmStreamWrite(self, (void *) "VERT", 4);
-  if(!_ctmStreamWritePackedInts(self, intVertices, self->mVertexCount, 3, CTM_FALSE))
-  {
-    free((void *) intVertices);
-    free((void *) sortVertices);
-    return CTM_FALSE;
-  }
+  _ctmStreamSetPacked(&streams[s ++], (void *) intVertices, self->mVertexCount, 3, CTM_FALSE, CTM_TRUE);
 
   // Prepare grid indices (deltas)
   gridIndices = (CTMuint *) malloc(sizeof(CTMuint) * self->mVertexCount);
   if(!gridIndices)
   {
     self->mError = CTM_OUT_OF_MEMORY;
-    free((void *) intVertices);
+    _ctmStreamFreePacked(streams, streamCount);
+    free((void *) streams);
     free((void *) sortVertices);
     return CTM_FALSE;
   }
   gridIndices[0] = sortVertices[0].mGridIndex;
   for(i = 1; i < self->mVertexCount; ++ i)
     gridIndices[i] = sortVertices[i].mGridIndex - sortVertices[i - 1].mGridIndex;
-  
-  // Write grid indices
-#ifdef __DEBUG_
-  printf("Grid indices: ");
-#endif
-  _ctmStreamWrite(self, (void *) "GIDX", 4);
-  if(!_ctmStreamWritePackedInts(self, (CTMint *) gridIndices, self->mVertexCount, 1, CTM_FALSE))
-  {
-    free((void *) gridIndices);
-    free((void *) intVertices);
-    free((void *) sortVertices);
-    return CTM_FALSE;
-  }
+  _ctmStreamSetPacked(&streams[s ++], (void *) gridIndices, self->mVertexCount, 1, CTM_FALSE, CTM_TRUE);
 
   // Calculate the result of the compressed -> decompressed vertices, in order
   // to use the same vertex data for calculating nominal normals as the
   // decompression routine (i.e. compensate for the vertex error when
-  // calculating the normals)
+  // calculating the normals). The grid index deltas are kept for packing, so
+  // the absolute grid indices are taken from the sorted vertices.
   restoredVertices = (CTMfloat *) malloc(sizeof(CTMfloat) * 3 * self->mVertexCount);
-  if(!restoredVertices)
+  gridIndices = (CTMuint *) malloc(sizeof(CTMuint) * self->mVertexCount);
+  if(!restoredVertices || !gridIndices)
   {
     self->mError = CTM_OUT_OF_MEMORY;
-    free((void *) gridIndices);
-    free((void *) intVertices);
+    if(restoredVertices)
+      free((void *) restoredVertices);
+    if(gridIndices)
+      free((void *) gridIndices);
+    _ctmStreamFreePacked(streams, streamCount);
+    free((void *) streams);
     free((void *) sortVertices);
     return CTM_FALSE;
   }
-  for(i = 1; i < self->mVertexCount; ++ i)
-    gridIndices[i] += gridIndices[i - 1];
+  for(i = 0; i < self->mVertexCount; ++ i)
+    gridIndices[i] = sortVertices[i].mGridIndex;
   _ctmRestoreVertices(self, intVertices, gridIndices, &grid, restoredVertices);
 
   // Free temporary resources
   free((void *) gridIndices);
-  free((void *) intVertices);
 
   // Perpare (sort) indices
   indices = (CTMuint *) malloc(sizeof(CTMuint) * self->mTriangleCount * 3);
@@ -916,6 +911,8 @@ int _ctmCompressMesh_MG2(_CTMcontext * self)
   {
     self->mError = CTM_OUT_OF_MEMORY;
     free((void *) restoredVertices);
+    _ctmStreamFreePacked(streams, streamCount);
+    free((void *) streams);
     free((void *) sortVertices);
     return CTM_FALSE;
   }
@@ -923,6 +920,8 @@ int _ctmCompressMesh_MG2(_CTMcontext * self)
   {
     free((void *) indices);
     free((void *) restoredVertices);
+    _ctmStreamFreePacked(streams, streamCount);
+    free((void *) streams);
     free((void *) sortVertices);
     return CTM_FALSE;
   }
@@ -930,34 +929,20 @@ int _ctmCompressMesh_MG2(_CTMcontext * self)
 
   // Calculate index deltas (entropy-reduction)
   deltaIndices = (CTMuint *) malloc(sizeof(CTMuint) * self->mTriangleCount * 3);
-  if(!indices)
+  if(!deltaIndices)
   {
     self->mError = CTM_OUT_OF_MEMORY;
     free((void *) indices);
     free((void *) restoredVertices);
+    _ctmStreamFreePacked(streams, streamCount);
+    free((void *) streams);
     free((void *) sortVertices);
     return CTM_FALSE;
   }
   for(i = 0; i < self->mTriangleCount * 3; ++ i)
     deltaIndices[i] = indices[i];
   _ctmMakeIndexDeltas(self, deltaIndices);
-
-  // Write triangle indices
-#ifdef __DEBUG_
-  printf("Indices: ");
-#endif
-  _ctmStreamWrite(self, (void *) "INDX", 4);
-  if(!_ctmStreamWritePackedInts(self, (CTMint *) deltaIndices, self->mTriangleCount, 3, CTM_FALSE))
-  {
-    free((void *) deltaIndices);
-    free((void *) indices);
-    free((void *) restoredVertices);
-    free((void *) sortVertices);
-    return CTM_FALSE;
-  }
-
-  // Free temporary data for the indices
-  free((void *) deltaIndices);
+  _ctmStreamSetPacked(&streams[s ++], (void *) deltaIndices, self->mTriangleCount, 3, CTM_FALSE, CTM_TRUE);
 
   if(self->mNormals)
   {
@@ -968,111 +953,144 @@ int _ctmCompressMesh_MG2(_CTMcontext * self)
       self->mError = CTM_OUT_OF_MEMORY;
       free((void *) indices);
       free((void *) restoredVertices);
+      _ctmStreamFreePacked(streams, streamCount);
+      free((void *) streams);
       free((void *) sortVertices);
       return CTM_FALSE;
     }
+    _ctmStreamSetPacked(&streams[s ++], (void *) intNormals, self->mVertexCount, 3, CTM_FALSE, CTM_TRUE);
     if(!_ctmMakeNormalDeltas(self, intNormals, restoredVertices, indices, sortVertices))
     {
       free((void *) indices);
-      free((void *) intNormals);
       free((void *) restoredVertices);
+      _ctmStreamFreePacked(streams, streamCount);
+      free((void *) streams);
       free((void *) sortVertices);
       return CTM_FALSE;
     }
-
-    // Write normals
-#ifdef __DEBUG_
-    printf("Normals: ");
-#endif
-    _ctmStreamWrite(self, (void *) "NORM", 4);
-    if(!_ctmStreamWritePackedInts(self, intNormals, self->mVertexCount, 3, CTM_FALSE))
-    {
-      free((void *) indices);
-      free((void *) intNormals);
-      free((void *) restoredVertices);
-      free((void *) sortVertices);
-      return CTM_FALSE;
-    }
-
-    // Free temporary normal data
-    free((void *) intNormals);
   }
 
   // Free restored indices and vertices
   free((void *) indices);
   free((void *) restoredVertices);
 
-  // Write UV maps
-  map = self->mUVMaps;
-  while(map)
+  // Convert UV coordinates to integers and calculate deltas (entropy-reduction)
+  for(map = self->mUVMaps; map; map = map->mNext)
   {
-    // Convert UV coordinates to integers and calculate deltas (entropy-reduction)
     intUVCoords = (CTMint *) malloc(sizeof(CTMint) * 2 * self->mVertexCount);
     if(!intUVCoords)
     {
       self->mError = CTM_OUT_OF_MEMORY;
+      _ctmStreamFreePacked(streams, streamCount);
+      free((void *) streams);
       free((void *) sortVertices);
       return CTM_FALSE;
     }
     _ctmMakeUVCoordDeltas(self, map, intUVCoords, sortVertices);
-
-    // Write UV coordinates
-#ifdef __DEBUG_
-    printf("Texture coordinates (%s): ", map->mName ? map->mName : "no name");
-#endif
-    _ctmStreamWrite(self, (void *) "TEXC", 4);
-    _ctmStreamWriteSTRING(self, map->mName);
-    _ctmStreamWriteSTRING(self, map->mFileName);
-    _ctmStreamWriteFLOAT(self, map->mPrecision);
-    if(!_ctmStreamWritePackedInts(self, intUVCoords, self->mVertexCount, 2, CTM_TRUE))
-    {
-      free((void *) intUVCoords);
-      free((void *) sortVertices);
-      return CTM_FALSE;
-    }
-
-    // Free temporary UV coordinate data
-    free((void *) intUVCoords);
-
-    map = map->mNext;
+    _ctmStreamSetPacked(&streams[s ++], (void *) intUVCoords, self->mVertexCount, 2, CTM_TRUE, CTM_TRUE);
   }
 
-  // Write vertex attribute maps
-  map = self->mAttribMaps;
-  while(map)
+  // Convert vertex attributes to integers and calculate deltas (entropy-reduction)
+  for(map = self->mAttribMaps; map; map = map->mNext)
   {
-    // Convert vertex attributes to integers and calculate deltas (entropy-reduction)
     intAttribs = (CTMint *) malloc(sizeof(CTMint) * 4 * self->mVertexCount);
     if(!intAttribs)
     {
       self->mError = CTM_OUT_OF_MEMORY;
+      _ctmStreamFreePacked(streams, streamCount);
+      free((void *) streams);
       free((void *) sortVertices);
       return CTM_FALSE;
     }
     _ctmMakeAttribDeltas(self, map, intAttribs, sortVertices);
+    _ctmStreamSetPacked(&streams[s ++], (void *) intAttribs, self->mVertexCount, 4, CTM_TRUE, CTM_TRUE);
+  }
 
-    // Write vertex attributes
+  // Free temporary data
+  free((void *) sortVertices);
+
+  // Compress all streams (the streams are independent of each other)
+  if(!_ctmStreamPackAll(self, streams, streamCount))
+  {
+    _ctmStreamFreePacked(streams, streamCount);
+    free((void *) streams);
+    return CTM_FALSE;
+  }
+
+  // Write MG2-specific header information to the stream
+  _ctmStreamWrite(self, (void *) "MG2H", 4);
+  _ctmStreamWriteFLOAT(self, self->mVertexPrecision);
+  _ctmStreamWriteFLOAT(self, self->mNormalPrecision);
+  _ctmStreamWriteFLOAT(self, grid.mMin[0]);
+  _ctmStreamWriteFLOAT(self, grid.mMin[1]);
+  _ctmStreamWriteFLOAT(self, grid.mMin[2]);
+  _ctmStreamWriteFLOAT(self, grid.mMax[0]);
+  _ctmStreamWriteFLOAT(self, grid.mMax[1]);
+  _ctmStreamWriteFLOAT(self, grid.mMax[2]);
+  _ctmStreamWriteUINT(self, grid.mDivision[0]);
+  _ctmStreamWriteUINT(self, grid.mDivision[1]);
+  _ctmStreamWriteUINT(self, grid.mDivision[2]);
+
+  // Write vertices
+#ifdef __DEBUG_
+  printf("Vertices: ");
+#endif
+  s = 0;
+  _ctmStreamWrite(self, (void *) "VERT", 4);
+  _ctmStreamWritePackedStream(self, &streams[s ++]);
+
+  // Write grid indices
+#ifdef __DEBUG_
+  printf("Grid indices: ");
+#endif
+  _ctmStreamWrite(self, (void *) "GIDX", 4);
+  _ctmStreamWritePackedStream(self, &streams[s ++]);
+
+  // Write triangle indices
+#ifdef __DEBUG_
+  printf("Indices: ");
+#endif
+  _ctmStreamWrite(self, (void *) "INDX", 4);
+  _ctmStreamWritePackedStream(self, &streams[s ++]);
+
+  // Write normals
+  if(self->mNormals)
+  {
+#ifdef __DEBUG_
+    printf("Normals: ");
+#endif
+    _ctmStreamWrite(self, (void *) "NORM", 4);
+    _ctmStreamWritePackedStream(self, &streams[s ++]);
+  }
+
+  // Write UV maps
+  for(map = self->mUVMaps; map; map = map->mNext)
+  {
+#ifdef __DEBUG_
+    printf("Texture coordinates (%s): ", map->mName ? map->mName : "no name");
+#endif
+    _ctmStreamWrite(self, (void *) "TEXC", 4);
+    _ctmStreamWriteSTRING(self, map->mName);
+    _ctmStreamWriteSTRING(self, map->mFileName);
+    _ctmStreamWriteFLOAT(self, map->mPrecision);
+    _ctmStreamWritePackedStream(self, &streams[s ++]);
+  }
+
+  // Write vertex attribute maps
+  for(map = self->mAttribMaps; map; map = map->mNext)
+  {
 #ifdef __DEBUG_
     printf("Vertex attributes (%s): ", map->mName ? map->mName : "no name");
 #endif
     _ctmStreamWrite(self, (void *) "ATTR", 4);
     _ctmStreamWriteSTRING(self, map->mName);
     _ctmStreamWriteFLOAT(self, map->mPrecision);
-    if(!_ctmStreamWritePackedInts(self, intAttribs, self->mVertexCount, 4, CTM_TRUE))
-    {
-      free((void *) intAttribs);
-      free((void *) sortVertices);
-      return CTM_FALSE;
-    }
-
-    // Free temporary vertex attribute data
-    free((void *) intAttribs);
-
-    map = map->mNext;
+    _ctmStreamWritePackedStream(self, &streams[s ++]);
   }
 
   // Free temporary data
-  free((void *) sortVertices);
+  _ctmStreamFreePacked(streams, streamCount);
+  free((void *) streams);
 
   return CTM_TRUE;
 }
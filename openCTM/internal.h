@@ -28,6 +28,8 @@
 #ifndef __OPENCTM_INTERNAL_H_
 #define __OPENCTM_INTERNAL_H_
 
+#include <stddef.h>
+
 //-----------------------------------------------------------------------------
 // Constants
 //-----------------------------------------------------------------------------
@@ -50,6 +52,14 @@ struct _CTMfloatmap_struct {
   _CTMfloatmap * mNext; // Pointer to the next map in the list (linked list)
 };
 
+//-----------------------------------------------------------------------------
+// _CTMscratch - A scratch buffer of the context, grown as needed.
+//-----------------------------------------------------------------------------
+typedef struct {
+  unsigned char * mData;
+  size_t mSize;
+} _CTMscratch;
+
 //-----------------------------------------------------------------------------
 // _CTMcontext - Internal CTM context structure.
 //-----------------------------------------------------------------------------
@@ -102,8 +112,50 @@ typedef struct {
 
   // User data (for stream read/write - usually the stream handle)
   void * mUserData;
+
+  // Scratch buffers for packing/unpacking streams (reused between calls):
+  // slots 0 and 1 for single streams, then two per stream of _ctmStreamPackAll()
+  _CTMscratch * mScratch;
+  CTMuint mScratchCount;
+
+  // Compress the streams of large meshes on one thread each?
+  CTMint mParallelPacking;
 } _CTMcontext;
 
+//-----------------------------------------------------------------------------
+// _CTMpackedstream - A packed (interleaved + LZMA compressed) data stream that
+// is compressed into its own buffer, so that several streams of a mesh can be
+// compressed in parallel before they are written in order.
+//-----------------------------------------------------------------------------
+typedef struct {
+  // Source array (mCount * mSize 32-bit values)
+  void * mData;
+  CTMuint mCount;
+  CTMuint mSize;
+  CTMint mSignedInts;
+
+  // Free mData in _ctmStreamFreePacked()?
+  CTMint mOwnsData;
+
+  // LZMA compression level
+  CTMuint mCompressionLevel;
+
+  // Interleaved data, compressed data (both context scratch buffers) and LZMA
+  // props
+  unsigned char * mTmp;
+  unsigned char * mPacked;
+  size_t mPackedSize;
+  unsigned char mProps[5];
+
+  // Error code for this stream
+  CTMenum mError;
+} _CTMpackedstream;
+
+//-----------------------------------------------------------------------------
+// _CTMtaskfn - Task function for _ctmRunTasks().
+//-----------------------------------------------------------------------------
+typedef void (* _CTMtaskfn)(void * aArg);
+
 //-----------------------------------------------------------------------------
 // Macros
 //-----------------------------------------------------------------------------
@@ -125,6 +177,23 @@ int _ctmStreamReadPackedInts(_CTMcontext * self, CTMint * aData, CTMuint aCount,
 int _ctmStreamWritePackedInts(_CTMcontext * self, CTMint * aData, CTMuint aCount, CTMuint aSize, CTMint aSignedInts);
 int _ctmStreamReadPackedFloats(_CTMcontext * self, CTMfloat * aData, CTMuint aCount, CTMuint aSize);
 int _ctmStreamWritePackedFloats(_CTMcontext * self, CTMfloat * aData, CTMuint aCount, CTMuint aSize);
+void _ctmStreamFreeScratch(_CTMcontext * self);
+void _ctmStreamSetPacked(_CTMpackedstream * aStream, void * aData, CTMuint aCount, CTMuint aSize, CTMint aSignedInts, CTMint aOwnsData);
+int _ctmStreamPackAll(_CTMcontext * self, _CTMpackedstream * aStreams, CTMuint aCount);
+void _ctmStreamWritePackedStream(_CTMcontext * self, _CTMpackedstream * aStream);
+void _ctmStreamFreePacked(_CTMpackedstream * aStreams, CTMuint aCount);
+
+//-----------------------------------------------------------------------------
+// Funcion prototypes for thread.c
+//-----------------------------------------------------------------------------
+void _ctmRunTasks(_CTMtaskfn aFunc, void * aArgs, size_t aArgSize, CTMuint aCount);
+
+//-----------------------------------------------------------------------------
+// Funcion prototypes for sort.c
+//-----------------------------------------------------------------------------
+int _ctmRadixSort(CTMuint * aItems, CTMuint aCount, CTMuint aStride,
+  const CTMuint * aKeys, CTMuint aKeyCount);
+void _ctmSortTriangles(CTMuint * aIndices, CTMuint aTriangleCount);
 
 //-----------------------------------------------------------------------------
 // Funcion prototypes for compressRAW.c
@@ -217,6 +217,9 @@ CTMEXPORT void CTMCALL ctmFreeContext(CTMcontext aContext)
   if(self->mFileComment)
     free(self->mFileComment);
 
+  // Free the stream scratch buffers
+  _ctmStreamFreeScratch(self);
+
   // Free the context
   free(self);
 }
@@ -693,6 +696,26 @@ CTMEXPORT void CTMCALL ctmCompressionLevel(CTMcontext aContext,
   self->mCompressionLevel = aLevel;
 }
 
+//-----------------------------------------------------------------------------
+// ctmParallelPacking()
+//-----------------------------------------------------------------------------
+CTMEXPORT void CTMCALL ctmParallelPacking(CTMcontext aContext,
+  CTMint aEnable)
+{
+  _CTMcontext * self = (_CTMcontext *) aContext;
+  if(!self) return;
+
+  // You are only allowed to change compression attributes in export mode
+  if(self->mMode != CTM_EXPORT)
+  {
+    self->mError = CTM_INVALID_OPERATION;
+    return;
+  }
+
+  // Enable or disable one thread per stream
+  self->mParallelPacking = aEnable ? CTM_TRUE : CTM_FALSE;
+}
+
 //-----------------------------------------------------------------------------
 // ctmVertexPrecision()
 //-----------------------------------------------------------------------------
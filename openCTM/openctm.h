@@ -471,6 +471,17 @@ CTMEXPORT void CTMCALL ctmCompressionMethod(CTMcontext aContext,
 CTMEXPORT void CTMCALL ctmCompressionLevel(CTMcontext aContext,
   CTMuint aLevel);
 
+/// Enable or disable parallel packing for the given OpenCTM context. When
+/// enabled, the streams of a large mesh (indices, vertices, normals and maps)
+/// are compressed with one thread each. The output is the same either way.
+/// Parallel packing is disabled by default; leave it disabled when several
+/// meshes are already compressed at once.
+/// @param[in] aContext An OpenCTM context that has been created by
+///            ctmNewContext().
+/// @param[in] aEnable CTM_TRUE to compress the streams in parallel.
+CTMEXPORT void CTMCALL ctmParallelPacking(CTMcontext aContext,
+  CTMint aEnable);
+
 /// Set the vertex coordinate precision (only used by the MG2 compression
 /// method).
 /// @param[in] aContext An OpenCTM context that has been created by
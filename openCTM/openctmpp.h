@@ -281,6 +281,13 @@ class CTMexporter {
       CheckError();
     }
 
+    /// Wrapper for ctmParallelPacking()
+    void ParallelPacking(bool aEnable)
+    {
+      ctmParallelPacking(mContext, aEnable ? CTM_TRUE : CTM_FALSE);
+      CheckError();
+    }
+
     /// Wrapper for ctmVertexPrecision()
     void VertexPrecision(CTMfloat aPrecision)
     {
@@ -0,0 +1,153 @@
+//-----------------------------------------------------------------------------
+// Product:     OpenCTM
+// File:        sort.c
+// Description: Radix sorting of fixed size integer records.
+//-----------------------------------------------------------------------------
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//     1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//     2. Altered source versions must be plainly marked as such, and must not
+//     be misrepresented as being the original software.
+//
+//     3. This notice may not be removed or altered from any source
+//     distribution.
+//-----------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+#include "openctm.h"
+#include "internal.h"
+
+
+//-----------------------------------------------------------------------------
+// _ctmRadixSort() - Stable LSD radix sort of an array of records, where each
+// record is aStride consecutive CTMuint words. The records are ordered by the
+// aKeyCount words given in aKeys (word offsets within the record, the most
+// significant key first), each compared as an unsigned integer. Records with
+// equal keys keep their original relative order.
+// Returns CTM_FALSE if the temporary buffers could not be allocated (the array
+// is then left untouched).
+//-----------------------------------------------------------------------------
+int _ctmRadixSort(CTMuint * aItems, CTMuint aCount, CTMuint aStride,
+  const CTMuint * aKeys, CTMuint aKeyCount)
+{
+  CTMuint * hist, * h, * tmp, * src, * dst, * s, * d, * swp;
+  CTMuint passCount, pass, i, k, word, shift, sum, c;
+
+  if(aCount < 2 || aKeyCount == 0)
+    return CTM_TRUE;
+
+  // One pass per key byte, least significant byte of the last key first
+  passCount = aKeyCount * 4;
+  hist = (CTMuint *) calloc(passCount * 256, sizeof(CTMuint));
+  if(!hist)
+    return CTM_FALSE;
+  tmp = (CTMuint *) malloc(sizeof(CTMuint) * aCount * aStride);
+  if(!tmp)
+  {
+    free((void *) hist);
+    return CTM_FALSE;
+  }
+
+  // Build the histograms for all passes in a single sweep
+  for(i = 0; i < aCount; ++ i)
+  {
+    s = &aItems[i * aStride];
+    for(k = 0; k < aKeyCount; ++ k)
+    {
+      word = s[aKeys[k]];
+      h = &hist[(aKeyCount - 1 - k) * 4 * 256];
+      ++ h[word & 0x000000ff];
+      ++ h[256 + ((word >> 8) & 0x000000ff)];
+      ++ h[512 + ((word >> 16) & 0x000000ff)];
+      ++ h[768 + ((word >> 24) & 0x000000ff)];
+    }
+  }
+
+  src = aItems;
+  dst = tmp;
+  for(pass = 0; pass < passCount; ++ pass)
+  {
+    h = &hist[pass * 256];
+    word = aKeys[aKeyCount - 1 - pass / 4];
+    shift = (pass % 4) * 8;
+
+    // Skip the pass if all records share the same digit (typical for the
+    // high bytes of indices and grid indices)
+    if(h[(src[word] >> shift) & 0x000000ff] == aCount)
+      continue;
+
+    // Convert the histogram to bucket offsets
+    sum = 0;
+    for(k = 0; k < 256; ++ k)
+    {
+      c = h[k];
+      h[k] = sum;
+      sum += c;
+    }
+
+    // Scatter the records
+    for(i = 0; i < aCount; ++ i)
+    {
+      s = &src[i * aStride];
+      d = &dst[(h[(s[word] >> shift) & 0x000000ff] ++) * aStride];
+      for(k = 0; k < aStride; ++ k)
+        d[k] = s[k];
+    }
+
+    swp = src;
+    src = dst;
+    dst = swp;
+  }
+
+  // Copy back if the result ended up in the temporary buffer
+  if(src != aItems)
+    memcpy((void *) aItems, (void *) src, sizeof(CTMuint) * aCount * aStride);
+
+  free((void *) tmp);
+  free((void *) hist);
+
+  return CTM_TRUE;
+}
+
+//-----------------------------------------------------------------------------
+// _compareTriangle() - Comparator for the triangle sorting (used when the
+// radix sort can not allocate its temporary buffers).
+//-----------------------------------------------------------------------------
+static int _compareTriangle(const void * elem1, const void * elem2)
+{
+  CTMuint * tri1 = (CTMuint *) elem1;
+  CTMuint * tri2 = (CTMuint *) elem2;
+  if(tri1[0] != tri2[0])
+    return tri1[0] < tri2[0] ? -1 : 1;
+  else if(tri1[1] != tri2[1])
+    return tri1[1] < tri2[1] ? -1 : 1;
+  else if(tri1[2] != tri2[2])
+    return tri1[2] < tri2[2] ? -1 : 1;
+  else
+    return 0;
+}
+
+//-----------------------------------------------------------------------------
+// _ctmSortTriangles() - Sort triangles by their first, second and third index.
+// The key is the whole triangle, so triangles that compare equal are identical
+// and the order does not depend on the stability of the sort (the radix sort
+// and the qsort fallback give the same result with any C library).
+//-----------------------------------------------------------------------------
+void _ctmSortTriangles(CTMuint * aIndices, CTMuint aTriangleCount)
+{
+  static const CTMuint keys[3] = { 0, 1, 2 };
+
+  if(!_ctmRadixSort(aIndices, aTriangleCount, 3, keys, 3))
+    qsort((void *) aIndices, aTriangleCount, sizeof(CTMuint) * 3, _compareTriangle);
+}
@@ -31,6 +31,19 @@
 #include "openctm.h"
 #include "internal.h"
 
+// SSE2 is always available on x86-64, and on x86 when enabled by the compiler
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+  #include <emmintrin.h>
+  #define _CTM_USE_SSE2
+#endif
+
+// Number of 32-bit words that are interleaved per cache block
+#define _CTM_PLANE_BLOCK 1024
+
+// Minimum total size (in bytes) of a mesh's packed streams for compressing
+// them in parallel
+#define _CTM_PARALLEL_MIN_SIZE (256 * 1024)
+
 #ifdef __DEBUG_
 #include <stdio.h>
 #endif
@@ -168,15 +181,246 @@ void _ctmStreamWriteSTRING(_CTMcontext * self, const char * aValue)
 }
 
 //-----------------------------------------------------------------------------
-// _ctmStreamReadPackedInts() - Read an compressed binary integer data array
-// from a stream, and uncompress it.
+// _ctmGetScratch() - Get one of the context scratch buffers, with room for at
+// least aSize bytes. The buffers are kept in the context and reused by later
+// calls, and freed by _ctmStreamFreeScratch(). Growing a slot does not move
+// the buffers of the other slots.
 //-----------------------------------------------------------------------------
-int _ctmStreamReadPackedInts(_CTMcontext * self, CTMint * aData,
+static unsigned char * _ctmGetScratch(_CTMcontext * self, CTMuint aSlot, size_t aSize)
+{
+  _CTMscratch * scratch;
+
+  if(aSlot >= self->mScratchCount)
+  {
+    scratch = (_CTMscratch *) realloc(self->mScratch, sizeof(_CTMscratch) * (aSlot + 1));
+    if(!scratch)
+    {
+      self->mError = CTM_OUT_OF_MEMORY;
+      return (unsigned char *) 0;
+    }
+    memset(scratch + self->mScratchCount, 0, sizeof(_CTMscratch) * (aSlot + 1 - self->mScratchCount));
+    self->mScratch = scratch;
+    self->mScratchCount = aSlot + 1;
+  }
+  scratch = &self->mScratch[aSlot];
+
+  if(aSize < 1)
+    aSize = 1;
+  if(aSize > scratch->mSize)
+  {
+    // The old contents are not needed, so skip realloc() copying
+    if(scratch->mData)
+      free(scratch->mData);
+    scratch->mData = (unsigned char *) malloc(aSize);
+    scratch->mSize = scratch->mData ? aSize : 0;
+    if(!scratch->mData)
+    {
+      self->mError = CTM_OUT_OF_MEMORY;
+      return (unsigned char *) 0;
+    }
+  }
+  return scratch->mData;
+}
+
+//-----------------------------------------------------------------------------
+// _ctmStreamFreeScratch() - Free the context scratch buffers.
+//-----------------------------------------------------------------------------
+void _ctmStreamFreeScratch(_CTMcontext * self)
+{
+  CTMuint i;
+  for(i = 0; i < self->mScratchCount; ++ i)
+  {
+    if(self->mScratch[i].mData)
+      free(self->mScratch[i].mData);
+  }
+  if(self->mScratch)
+    free(self->mScratch);
+  self->mScratch = (_CTMscratch *) 0;
+  self->mScratchCount = 0;
+}
+
+//-----------------------------------------------------------------------------
+// _ctmSplitBytePlanes() - Split aCount 32-bit words into four byte planes,
+// aPlaneStride bytes apart. The first plane holds the most significant bytes.
+//-----------------------------------------------------------------------------
+static void _ctmSplitBytePlanes(const CTMuint * aSrc, CTMuint aCount,
+  unsigned char * aDst, size_t aPlaneStride)
+{
+  CTMuint i = 0, value;
+#ifdef _CTM_USE_SSE2
+  __m128i a, b, c, d, p, q, r, t0, t1, u0, u1;
+
+  // Transpose 16 words at a time: after three rounds of byte unpacking each
+  // register holds the same byte of eight consecutive words in each half
+  for(; i + 16 <= aCount; i += 16)
+  {
+    a = _mm_loadu_si128((const __m128i *) &aSrc[i]);
+    b = _mm_loadu_si128((const __m128i *) &aSrc[i + 4]);
+    c = _mm_loadu_si128((const __m128i *) &aSrc[i + 8]);
+    d = _mm_loadu_si128((const __m128i *) &aSrc[i + 12]);
+
+    p = _mm_unpacklo_epi8(a, b);
+    q = _mm_unpackhi_epi8(a, b);
+    r = _mm_unpacklo_epi8(p, q);
+    q = _mm_unpackhi_epi8(p, q);
+    t0 = _mm_unpacklo_epi8(r, q);   // bytes 0 and 1 of words 0-7
+    u0 = _mm_unpackhi_epi8(r, q);   // bytes 2 and 3 of words 0-7
+
+    p = _mm_unpacklo_epi8(c, d);
+    q = _mm_unpackhi_epi8(c, d);
+    r = _mm_unpacklo_epi8(p, q);
+    q = _mm_unpackhi_epi8(p, q);
+    t1 = _mm_unpacklo_epi8(r, q);   // bytes 0 and 1 of words 8-15
+    u1 = _mm_unpackhi_epi8(r, q);   // bytes 2 and 3 of words 8-15
+
+    _mm_storeu_si128((__m128i *) &aDst[i], _mm_unpackhi_epi64(u0, u1));
+    _mm_storeu_si128((__m128i *) &aDst[aPlaneStride + i], _mm_unpacklo_epi64(u0, u1));
+    _mm_storeu_si128((__m128i *) &aDst[2 * aPlaneStride + i], _mm_unpackhi_epi64(t0, t1));
+    _mm_storeu_si128((__m128i *) &aDst[3 * aPlaneStride + i], _mm_unpacklo_epi64(t0, t1));
+  }
+#endif
+
+  for(; i < aCount; ++ i)
+  {
+    value = aSrc[i];
+    aDst[i] = (value >> 24) & 0x000000ff;
+    aDst[aPlaneStride + i] = (value >> 16) & 0x000000ff;
+    aDst[2 * aPlaneStride + i] = (value >> 8) & 0x000000ff;
+    aDst[3 * aPlaneStride + i] = value & 0x000000ff;
+  }
+}
+
+//-----------------------------------------------------------------------------
+// _ctmMergeBytePlanes() - Inverse of _ctmSplitBytePlanes().
+//-----------------------------------------------------------------------------
+static void _ctmMergeBytePlanes(const unsigned char * aSrc, size_t aPlaneStride,
+  CTMuint aCount, CTMuint * aDst)
+{
+  CTMuint i = 0;
+#ifdef _CTM_USE_SSE2
+  __m128i p0, p1, p2, p3, lo, hi;
+
+  for(; i + 16 <= aCount; i += 16)
+  {
+    p0 = _mm_loadu_si128((const __m128i *) &aSrc[i]);
+    p1 = _mm_loadu_si128((const __m128i *) &aSrc[aPlaneStride + i]);
+    p2 = _mm_loadu_si128((const __m128i *) &aSrc[2 * aPlaneStride + i]);
+    p3 = _mm_loadu_si128((const __m128i *) &aSrc[3 * aPlaneStride + i]);
+
+    lo = _mm_unpacklo_epi8(p3, p2);
+    hi = _mm_unpacklo_epi8(p1, p0);
+    _mm_storeu_si128((__m128i *) &aDst[i], _mm_unpacklo_epi16(lo, hi));
+    _mm_storeu_si128((__m128i *) &aDst[i + 4], _mm_unpackhi_epi16(lo, hi));
+
+    lo = _mm_unpackhi_epi8(p3, p2);
+    hi = _mm_unpackhi_epi8(p1, p0);
+    _mm_storeu_si128((__m128i *) &aDst[i + 8], _mm_unpacklo_epi16(lo, hi));
+    _mm_storeu_si128((__m128i *) &aDst[i + 12], _mm_unpackhi_epi16(lo, hi));
+  }
+#endif
+
+  for(; i < aCount; ++ i)
+  {
+    aDst[i] = ((CTMuint) aSrc[3 * aPlaneStride + i]) |
+              (((CTMuint) aSrc[2 * aPlaneStride + i]) << 8) |
+              (((CTMuint) aSrc[aPlaneStride + i]) << 16) |
+              (((CTMuint) aSrc[i]) << 24);
+  }
+}
+
+//-----------------------------------------------------------------------------
+// _ctmInterleave() - Convert an array of aCount elements with aSize 32-bit
+// components each to the interleaved byte plane layout used by the packed
+// streams: for each byte (most significant first), for each component, the
+// bytes of all elements.
+//-----------------------------------------------------------------------------
+static void _ctmInterleave(const void * aData, CTMuint aCount, CTMuint aSize,
+  CTMint aSignedInts, unsigned char * aDst)
+{
+  CTMuint block[_CTM_PLANE_BLOCK];
+  const unsigned char * src = (const unsigned char *) aData;
+  size_t planeStride = (size_t) aCount * aSize;
+  CTMuint i, j, k, n;
+  CTMint value;
+
+  // Plain 32-bit streams need no component gathering
+  if((aSize == 1) && !aSignedInts)
+  {
+    for(i = 0; i < aCount; i += n)
+    {
+      n = (aCount - i < _CTM_PLANE_BLOCK) ? aCount - i : _CTM_PLANE_BLOCK;
+      memcpy(block, src + (size_t) i * 4, n * 4);
+      _ctmSplitBytePlanes(block, n, aDst + i, planeStride);
+    }
+    return;
+  }
+
+  // Work on blocks of elements, so that the source data stays in the cache
+  // while its components are gathered one at a time
+  for(i = 0; i < aCount; i += n)
+  {
+    n = (aCount - i < _CTM_PLANE_BLOCK) ? aCount - i : _CTM_PLANE_BLOCK;
+    for(k = 0; k < aSize; ++ k)
+    {
+      for(j = 0; j < n; ++ j)
+      {
+        memcpy(&value, src + (((size_t) i + j) * aSize + k) * 4, 4);
+        // Convert two's complement to signed magnitude?
+        if(aSignedInts)
+          value = value < 0 ? -1 - (value << 1) : value << 1;
+        block[j] = (CTMuint) value;
+      }
+      _ctmSplitBytePlanes(block, n, aDst + (size_t) k * aCount + i, planeStride);
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+// _ctmDeinterleave() - Inverse of _ctmInterleave().
+//-----------------------------------------------------------------------------
+static void _ctmDeinterleave(const unsigned char * aSrc, CTMuint aCount,
+  CTMuint aSize, CTMint aSignedInts, void * aData)
+{
+  CTMuint block[_CTM_PLANE_BLOCK];
+  unsigned char * dst = (unsigned char *) aData;
+  size_t planeStride = (size_t) aCount * aSize;
+  CTMuint i, j, k, n, x;
+  CTMint value;
+
+  for(i = 0; i < aCount; i += n)
+  {
+    n = (aCount - i < _CTM_PLANE_BLOCK) ? aCount - i : _CTM_PLANE_BLOCK;
+    for(k = 0; k < aSize; ++ k)
+    {
+      _ctmMergeBytePlanes(aSrc + (size_t) k * aCount + i, planeStride, n, block);
+      if((aSize == 1) && !aSignedInts)
+      {
+        memcpy(dst + (size_t) i * 4, block, n * 4);
+        continue;
+      }
+      for(j = 0; j < n; ++ j)
+      {
+        value = (CTMint) block[j];
+        // Convert signed magnitude to two's complement?
+        if(aSignedInts)
+        {
+          x = (CTMuint) value;
+          value = (x & 1) ? -(CTMint)((x + 1) >> 1) : (CTMint)(x >> 1);
+        }
+        memcpy(dst + (((size_t) i + j) * aSize + k) * 4, &value, 4);
+      }
+    }
+  }
+}
+
+//-----------------------------------------------------------------------------
+// _ctmStreamReadPacked() - Read an compressed binary 32-bit data array from a
+// stream, and uncompress it.
+//-----------------------------------------------------------------------------
+static int _ctmStreamReadPacked(_CTMcontext * self, void * aData,
   CTMuint aCount, CTMuint aSize, CTMint aSignedInts)
 {
   size_t packedSize, unpackedSize;
-  CTMuint i, k, x;
-  CTMint value;
   unsigned char * packed, * tmp;
   unsigned char props[5];
   int lzmaRes;
@@ -187,146 +431,94 @@ int _ctmStreamReadPackedInts(_CTMcontext * self, CTMint * aData,
   // Read LZMA compression props from the stream
   _ctmStreamRead(self, (void *) props, 5);
 
-  // Allocate memory and read the packed data from the stream
-  packed = (unsigned char *) malloc(packedSize);
+  // Get memory and read the packed data from the stream
+  packed = _ctmGetScratch(self, 0, packedSize);
   if(!packed)
-  {
-    self->mError = CTM_OUT_OF_MEMORY;
     return CTM_FALSE;
-  }
   _ctmStreamRead(self, (void *) packed, packedSize);
 
-  // Allocate memory for interleaved array
-  tmp = (unsigned char *) malloc(aCount * aSize * 4);
+  // Get memory for interleaved array
+  unpackedSize = (size_t) aCount * aSize * 4;
+  tmp = _ctmGetScratch(self, 1, unpackedSize);
   if(!tmp)
-  {
-    free(packed);
-    self->mError = CTM_OUT_OF_MEMORY;
     return CTM_FALSE;
-  }
 
   // Uncompress
-  unpackedSize = aCount * aSize * 4;
   lzmaRes = LzmaUncompress(tmp, &unpackedSize, packed,
                            &packedSize, props, 5);
 
-  // Free the packed array
-  free(packed);
-
   // Error?
-  if((lzmaRes != SZ_OK) || (unpackedSize != aCount * aSize * 4))
+  if((lzmaRes != SZ_OK) || (unpackedSize != (size_t) aCount * aSize * 4))
   {
     self->mError = CTM_LZMA_ERROR;
-    free(tmp);
     return CTM_FALSE;
   }
 
-  // Convert interleaved array to integers
-  for(i = 0; i < aCount; ++ i)
-  {
-    for(k = 0; k < aSize; ++ k)
-    {
-      value = (CTMint) tmp[i + k * aCount + 3 * aCount * aSize] |
-              (((CTMint) tmp[i + k * aCount + 2 * aCount * aSize]) << 8) |
-              (((CTMint) tmp[i + k * aCount + aCount * aSize]) << 16) |
-              (((CTMint) tmp[i + k * aCount]) << 24);
-      // Convert signed magnitude to two's complement?
-      if(aSignedInts)
-      {
-        x = (CTMuint) value;
-        value = (x & 1) ? -(CTMint)((x + 1) >> 1) : (CTMint)(x >> 1);
-      }
-      aData[i * aSize + k] = value;
-    }
-  }
-
-  // Free the interleaved array
-  free(tmp);
+  // Convert interleaved array to integers/floats
+  _ctmDeinterleave(tmp, aCount, aSize, aSignedInts, aData);
 
   return CTM_TRUE;
 }
 
 //-----------------------------------------------------------------------------
-// _ctmStreamWritePackedInts() - Compress a binary integer data array, and
-// write it to a stream.
+// _ctmLzmaCompress() - LZMA compress an interleaved array with the settings
+// used for all packed streams.
 //-----------------------------------------------------------------------------
-int _ctmStreamWritePackedInts(_CTMcontext * self, CTMint * aData,
+static int _ctmLzmaCompress(const unsigned char * aSrc, size_t aSrcSize,
+  unsigned char * aDst, size_t * aDstSize, unsigned char * aProps,
+  CTMuint aLevel)
+{
+  size_t outPropsSize = 5;
+  int lzmaAlgo = (aLevel < 1 ? 0 : 1);
+  return LzmaCompress(aDst,
+                      aDstSize,
+                      aSrc,
+                      aSrcSize,
+                      aProps,
+                      &outPropsSize,
+                      aLevel,                  // Level (0-9)
+                      0, -1, -1, -1, -1, -1,   // Default values (set by level)
+                      lzmaAlgo                 // Algorithm (0 = fast, 1 = normal)
+                     );
+}
+
+//-----------------------------------------------------------------------------
+// _ctmStreamWritePacked() - Compress a binary 32-bit data array, and write it
+// to a stream.
+//-----------------------------------------------------------------------------
+static int _ctmStreamWritePacked(_CTMcontext * self, const void * aData,
   CTMuint aCount, CTMuint aSize, CTMint aSignedInts)
 {
-  int lzmaRes, lzmaAlgo;
-  CTMuint i, k;
-  CTMint value;
-  size_t bufSize, outPropsSize;
+  int lzmaRes;
+  size_t unpackedSize, bufSize;
   unsigned char * packed, outProps[5], *tmp;
-#ifdef __DEBUG_
-  CTMuint negCount = 0;  
-#endif
 
-  // Allocate memory for interleaved array
-  tmp = (unsigned char *) malloc(aCount * aSize * 4);
+  // Get memory for interleaved array and packed data
+  unpackedSize = (size_t) aCount * aSize * 4;
+  tmp = _ctmGetScratch(self, 0, unpackedSize);
   if(!tmp)
-  {
-    self->mError = CTM_OUT_OF_MEMORY;
     return CTM_FALSE;
-  }
-
-  // Convert integers to an interleaved array
-  for(i = 0; i < aCount; ++ i)
-  {
-    for(k = 0; k < aSize; ++ k)
-    {
-      value = aData[i * aSize + k];
-      // Convert two's complement to signed magnitude?
-      if(aSignedInts)
-        value = value < 0 ? -1 - (value << 1) : value << 1;
-#ifdef __DEBUG_
-      else if(value < 0)
-        ++ negCount;
-#endif
-      tmp[i + k * aCount + 3 * aCount * aSize] = value & 0x000000ff;
-      tmp[i + k * aCount + 2 * aCount * aSize] = (value >> 8) & 0x000000ff;
-      tmp[i + k * aCount + aCount * aSize] = (value >> 16) & 0x000000ff;
-      tmp[i + k * aCount] = (value >> 24) & 0x000000ff;
-    }
-  }
-
-  // Allocate memory for the packed data
-  bufSize = 1000 + aCount * aSize * 4;
-  packed = (unsigned char *) malloc(bufSize);
+  bufSize = 1000 + unpackedSize;
+  packed = _ctmGetScratch(self, 1, bufSize);
   if(!packed)
-  {
-    free(tmp);
-    self->mError = CTM_OUT_OF_MEMORY;
     return CTM_FALSE;
-  }
+
+  // Convert integers/floats to an interleaved array
+  _ctmInterleave(aData, aCount, aSize, aSignedInts, tmp);
 
   // Call LZMA to compress
-  outPropsSize = 5;
-  lzmaAlgo = (self->mCompressionLevel < 1 ? 0 : 1);
-  lzmaRes = LzmaCompress(packed,
-                         &bufSize,
-                         (const unsigned char *) tmp,
-                         aCount * aSize * 4,
-                         outProps,
-                         &outPropsSize,
-                         self->mCompressionLevel, // Level (0-9)
-                         0, -1, -1, -1, -1, -1,   // Default values (set by level)
-                         lzmaAlgo                 // Algorithm (0 = fast, 1 = normal)
-                        );
-
-  // Free temporary array
-  free(tmp);
+  lzmaRes = _ctmLzmaCompress(tmp, unpackedSize, packed, &bufSize, outProps,
+                             self->mCompressionLevel);
 
   // Error?
   if(lzmaRes != SZ_OK)
   {
     self->mError = CTM_LZMA_ERROR;
-    free(packed);
     return CTM_FALSE;
   }
 
 #ifdef __DEBUG_
-  printf("%d->%d bytes (%d negative words)\n", aCount * aSize * 4, (int) bufSize, negCount);
+  printf("%d->%d bytes\n", (int) unpackedSize, (int) bufSize);
 #endif
 
   // Write packed data size to the stream
@@ -338,175 +530,168 @@ int _ctmStreamWritePackedInts(_CTMcontext * self, CTMint * aData,
   // Write the packed data to the stream
   _ctmStreamWrite(self, (void *) packed, (CTMuint) bufSize);
 
-  // Free the packed data
-  free(packed);
-
   return CTM_TRUE;
 }
 
 //-----------------------------------------------------------------------------
-// _ctmStreamReadPackedFloats() - Read an compressed binary float data array
-// from a stream, and uncompress it.
+// _ctmStreamSetPacked() - Describe the source data of a packed stream.
 //-----------------------------------------------------------------------------
-int _ctmStreamReadPackedFloats(_CTMcontext * self, CTMfloat * aData,
-  CTMuint aCount, CTMuint aSize)
+void _ctmStreamSetPacked(_CTMpackedstream * aStream, void * aData,
+  CTMuint aCount, CTMuint aSize, CTMint aSignedInts, CTMint aOwnsData)
 {
-  CTMuint i, k;
-  size_t packedSize, unpackedSize;
-  union {
-    CTMfloat f;
-    CTMint i;
-  } value;
-  unsigned char * packed, * tmp;
-  unsigned char props[5];
+  aStream->mData = aData;
+  aStream->mCount = aCount;
+  aStream->mSize = aSize;
+  aStream->mSignedInts = aSignedInts;
+  aStream->mOwnsData = aOwnsData;
+  aStream->mTmp = (unsigned char *) 0;
+  aStream->mPacked = (unsigned char *) 0;
+  aStream->mPackedSize = 0;
+  aStream->mError = CTM_NONE;
+}
+
+//-----------------------------------------------------------------------------
+// _ctmPackStream() - Interleave and compress one packed stream into its
+// buffers. Only aStream is touched, so streams can be packed in parallel.
+//-----------------------------------------------------------------------------
+static void _ctmPackStream(void * aArg)
+{
+  _CTMpackedstream * stream = (_CTMpackedstream *) aArg;
+  size_t unpackedSize;
   int lzmaRes;
 
-  // Read packed data size from the stream
-  packedSize = (size_t) _ctmStreamReadUINT(self);
+  // Convert integers/floats to an interleaved array, and compress it
+  unpackedSize = (size_t) stream->mCount * stream->mSize * 4;
+  _ctmInterleave(stream->mData, stream->mCount, stream->mSize,
+                 stream->mSignedInts, stream->mTmp);
+  lzmaRes = _ctmLzmaCompress(stream->mTmp, unpackedSize, stream->mPacked,
+                             &stream->mPackedSize, stream->mProps,
+                             stream->mCompressionLevel);
 
-  // Read LZMA compression props from the stream
-  _ctmStreamRead(self, (void *) props, 5);
+  if(lzmaRes != SZ_OK)
+    stream->mError = CTM_LZMA_ERROR;
+}
 
-  // Allocate memory and read the packed data from the stream
-  packed = (unsigned char *) malloc(packedSize);
-  if(!packed)
-  {
-    self->mError = CTM_OUT_OF_MEMORY;
-    return CTM_FALSE;
-  }
-  _ctmStreamRead(self, (void *) packed, packedSize);
+//-----------------------------------------------------------------------------
+// _ctmStreamPackAll() - Compress all given packed streams, into two context
+// scratch buffers per stream (the compressed data stays valid until the next
+// call). With parallel packing enabled, meshes that are large enough are
+// compressed with one thread per stream.
+//-----------------------------------------------------------------------------
+int _ctmStreamPackAll(_CTMcontext * self, _CTMpackedstream * aStreams,
+  CTMuint aCount)
+{
+  size_t totalSize = 0, unpackedSize;
+  CTMuint i;
 
-  // Allocate memory for interleaved array
-  tmp = (unsigned char *) malloc(aCount * aSize * 4);
-  if(!tmp)
+  // The buffers are taken on this thread: the context is not thread safe
+  for(i = 0; i < aCount; ++ i)
   {
-    free(packed);
-    self->mError = CTM_OUT_OF_MEMORY;
-    return CTM_FALSE;
+    aStreams[i].mCompressionLevel = self->mCompressionLevel;
+    unpackedSize = (size_t) aStreams[i].mCount * aStreams[i].mSize * 4;
+    aStreams[i].mTmp = _ctmGetScratch(self, 2 + 2 * i, unpackedSize);
+    aStreams[i].mPackedSize = 1000 + unpackedSize;
+    aStreams[i].mPacked = _ctmGetScratch(self, 3 + 2 * i, aStreams[i].mPackedSize);
+    if(!aStreams[i].mTmp || !aStreams[i].mPacked)
+      return CTM_FALSE;
+    totalSize += unpackedSize;
   }
 
-  // Uncompress
-  unpackedSize = aCount * aSize * 4;
-  lzmaRes = LzmaUncompress(tmp, &unpackedSize, packed,
-                           &packedSize, props, 5);
-
-  // Free the packed array
-  free(packed);
-
-  // Error?
-  if((lzmaRes != SZ_OK) || (unpackedSize != aCount * aSize * 4))
+  // Thread start-up is not worth it for small meshes
+  if(self->mParallelPacking && (aCount > 1) && (totalSize >= _CTM_PARALLEL_MIN_SIZE))
+    _ctmRunTasks(_ctmPackStream, (void *) aStreams, sizeof(_CTMpackedstream), aCount);
+  else
   {
-    self->mError = CTM_LZMA_ERROR;
-    free(tmp);
-    return CTM_FALSE;
+    for(i = 0; i < aCount; ++ i)
+      _ctmPackStream((void *) &aStreams[i]);
   }
 
-  // Convert interleaved array to floats
+  // Report the first error, if any
   for(i = 0; i < aCount; ++ i)
-  {
-    for(k = 0; k < aSize; ++ k)
-    {
-      value.i = (CTMint) tmp[i + k * aCount + 3 * aCount * aSize] |
-                (((CTMint) tmp[i + k * aCount + 2 * aCount * aSize]) << 8) |
-                (((CTMint) tmp[i + k * aCount + aCount * aSize]) << 16) |
-                (((CTMint) tmp[i + k * aCount]) << 24);
-      aData[i * aSize + k] = value.f;
+  {
+    if(aStreams[i].mError != CTM_NONE)
+    {
+      self->mError = aStreams[i].mError;
+      return CTM_FALSE;
     }
   }
 
-  // Free the interleaved array
-  free(tmp);
-
   return CTM_TRUE;
 }
 
 //-----------------------------------------------------------------------------
-// _ctmStreamWritePackedFloats() - Compress a binary float data array, and
-// write it to a stream.
+// _ctmStreamWritePackedStream() - Write a compressed packed stream to the
+// stream (same format as _ctmStreamWritePackedInts/Floats).
 //-----------------------------------------------------------------------------
-int _ctmStreamWritePackedFloats(_CTMcontext * self, CTMfloat * aData,
-  CTMuint aCount, CTMuint aSize)
+void _ctmStreamWritePackedStream(_CTMcontext * self, _CTMpackedstream * aStream)
 {
-  int lzmaRes, lzmaAlgo;
-  CTMuint i, k;
-  union {
-    CTMfloat f;
-    CTMint i;
-  } value;
-  size_t bufSize, outPropsSize;
-  unsigned char * packed, outProps[5], *tmp;
-
-  // Allocate memory for interleaved array
-  tmp = (unsigned char *) malloc(aCount * aSize * 4);
-  if(!tmp)
-  {
-    self->mError = CTM_OUT_OF_MEMORY;
-    return CTM_FALSE;
-  }
-
-  // Convert floats to an interleaved array
-  for(i = 0; i < aCount; ++ i)
-  {
-    for(k = 0; k < aSize; ++ k)
-    {
-      value.f = aData[i * aSize + k];
-      tmp[i + k * aCount + 3 * aCount * aSize] = value.i & 0x000000ff;
-      tmp[i + k * aCount + 2 * aCount * aSize] = (value.i >> 8) & 0x000000ff;
-      tmp[i + k * aCount + aCount * aSize] = (value.i >> 16) & 0x000000ff;
-      tmp[i + k * aCount] = (value.i >> 24) & 0x000000ff;
-    }
-  }
-
-  // Allocate memory for the packed data
-  bufSize = 1000 + aCount * aSize * 4;
-  packed = (unsigned char *) malloc(bufSize);
-  if(!packed)
-  {
-    free(tmp);
-    self->mError = CTM_OUT_OF_MEMORY;
-    return CTM_FALSE;
-  }
-
-  // Call LZMA to compress
-  outPropsSize = 5;
-  lzmaAlgo = (self->mCompressionLevel < 1 ? 0 : 1);
-  lzmaRes = LzmaCompress(packed,
-                         &bufSize,
-                         (const unsigned char *) tmp,
-                         aCount * aSize * 4,
-                         outProps,
-                         &outPropsSize,
-                         self->mCompressionLevel, // Level (0-9)
-                         0, -1, -1, -1, -1, -1,   // Default values (set by level)
-                         lzmaAlgo                 // Algorithm (0 = fast, 1 = normal)
-                        );
-
-  // Free temporary array
-  free(tmp);
-
-  // Error?
-  if(lzmaRes != SZ_OK)
-  {
-    self->mError = CTM_LZMA_ERROR;
-    free(packed);
-    return CTM_FALSE;
-  }
-
 #ifdef __DEBUG_
-  printf("%d->%d bytes\n", aCount * aSize * 4, (int) bufSize);
+  printf("%d->%d bytes\n", (int) (aStream->mCount * aStream->mSize * 4), (int) aStream->mPackedSize);
 #endif
 
   // Write packed data size to the stream
-  _ctmStreamWriteUINT(self, (CTMuint) bufSize);
+  _ctmStreamWriteUINT(self, (CTMuint) aStream->mPackedSize);
 
   // Write LZMA compression props to the stream
-  _ctmStreamWrite(self, (void *) outProps, 5);
+  _ctmStreamWrite(self, (void *) aStream->mProps, 5);
 
   // Write the packed data to the stream
-  _ctmStreamWrite(self, (void *) packed, (CTMuint) bufSize);
+  _ctmStreamWrite(self, (void *) aStream->mPacked, (CTMuint) aStream->mPackedSize);
+}
 
-  // Free the packed data
-  free(packed);
+//-----------------------------------------------------------------------------
+// _ctmStreamFreePacked() - Free the owned source data of an array of packed
+// streams (their buffers belong to the context).
+//-----------------------------------------------------------------------------
+void _ctmStreamFreePacked(_CTMpackedstream * aStreams, CTMuint aCount)
+{
+  CTMuint i;
+  for(i = 0; i < aCount; ++ i)
+  {
+    aStreams[i].mTmp = (unsigned char *) 0;
+    aStreams[i].mPacked = (unsigned char *) 0;
+    if(aStreams[i].mOwnsData && aStreams[i].mData)
+      free(aStreams[i].mData);
+    aStreams[i].mData = (void *) 0;
+  }
+}
 
-  return CTM_TRUE;
+//-----------------------------------------------------------------------------
+// _ctmStreamReadPackedInts() - Read an compressed binary integer data array
+// from a stream, and uncompress it.
+//-----------------------------------------------------------------------------
+int _ctmStreamReadPackedInts(_CTMcontext * self, CTMint * aData,
+  CTMuint aCount, CTMuint aSize, CTMint aSignedInts)
+{
+  return _ctmStreamReadPacked(self, (void *) aData, aCount, aSize, aSignedInts);
+}
+
+//-----------------------------------------------------------------------------
+// _ctmStreamWritePackedInts() - Compress a binary integer data array, and
+// write it to a stream.
+//-----------------------------------------------------------------------------
+int _ctmStreamWritePackedInts(_CTMcontext * self, CTMint * aData,
+  CTMuint aCount, CTMuint aSize, CTMint aSignedInts)
+{
+  return _ctmStreamWritePacked(self, (const void *) aData, aCount, aSize, aSignedInts);
+}
+
+//-----------------------------------------------------------------------------
+// _ctmStreamReadPackedFloats() - Read an compressed binary float data array
+// from a stream, and uncompress it.
+//-----------------------------------------------------------------------------
+int _ctmStreamReadPackedFloats(_CTMcontext * self, CTMfloat * aData,
+  CTMuint aCount, CTMuint aSize)
+{
+  return _ctmStreamReadPacked(self, (void *) aData, aCount, aSize, CTM_FALSE);
+}
+
+//-----------------------------------------------------------------------------
+// _ctmStreamWritePackedFloats() - Compress a binary float data array, and
+// write it to a stream.
+//-----------------------------------------------------------------------------
+int _ctmStreamWritePackedFloats(_CTMcontext * self, CTMfloat * aData,
+  CTMuint aCount, CTMuint aSize)
+{
+  return _ctmStreamWritePacked(self, (const void *) aData, aCount, aSize, CTM_FALSE);
 }
@@ -0,0 +1,143 @@
+//-----------------------------------------------------------------------------
+// Product:     OpenCTM
+// File:        thread.c
+// Description: Minimal fork/join helper for running independent tasks on
+//              worker threads.
+//-----------------------------------------------------------------------------
+// This software is provided 'as-is', without any express or implied
+// warranty. In no event will the authors be held liable for any damages
+// arising from the use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it
+// freely, subject to the following restrictions:
+//
+//     1. The origin of this software must not be misrepresented; you must not
+//     claim that you wrote the original software. If you use this software
+//     in a product, an acknowledgment in the product documentation would be
+//     appreciated but is not required.
+//
+//     2. Altered source versions must be plainly marked as such, and must not
+//     be misrepresented as being the original software.
+//
+//     3. This notice may not be removed or altered from any source
+//     distribution.
+//-----------------------------------------------------------------------------
+
+#include <stdlib.h>
+#include "openctm.h"
+#include "internal.h"
+
+#ifdef _WIN32
+  #include <windows.h>
+#else
+  #include <pthread.h>
+#endif
+
+
+//-----------------------------------------------------------------------------
+// _CTMtask - A task and its argument, as passed to a worker thread.
+//-----------------------------------------------------------------------------
+typedef struct {
+  _CTMtaskfn mFunc;
+  void * mArg;
+} _CTMtask;
+
+#ifdef _WIN32
+static DWORD WINAPI _ctmThreadMain(LPVOID aArg)
+{
+  _CTMtask * task = (_CTMtask *) aArg;
+  task->mFunc(task->mArg);
+  return 0;
+}
+#else
+static void * _ctmThreadMain(void * aArg)
+{
+  _CTMtask * task = (_CTMtask *) aArg;
+  task->mFunc(task->mArg);
+  return (void *) 0;
+}
+#endif
+
+//-----------------------------------------------------------------------------
+// _ctmRunTasks() - Call aFunc for each of the aCount arguments in aArgs (an
+// array of aArgSize byte elements), one thread per argument, and wait until
+// all calls have returned. The last task runs on the calling thread. Tasks
+// whose thread can not be created are run on the calling thread as well, so
+// all tasks are always completed.
+//-----------------------------------------------------------------------------
+void _ctmRunTasks(_CTMtaskfn aFunc, void * aArgs, size_t aArgSize,
+  CTMuint aCount)
+{
+  _CTMtask * tasks;
+  CTMint * started;
+  CTMuint i;
+#ifdef _WIN32
+  HANDLE * threads;
+#else
+  pthread_t * threads;
+#endif
+
+  if(aCount == 0)
+    return;
+
+  tasks = (_CTMtask *) malloc(sizeof(_CTMtask) * aCount);
+  started = (CTMint *) malloc(sizeof(CTMint) * aCount);
+#ifdef _WIN32
+  threads = (HANDLE *) malloc(sizeof(HANDLE) * aCount);
+#else
+  threads = (pthread_t *) malloc(sizeof(pthread_t) * aCount);
+#endif
+  if(!tasks || !started || !threads)
+  {
+    // Fall back to running everything serially
+    if(tasks) free((void *) tasks);
+    if(started) free((void *) started);
+    if(threads) free((void *) threads);
+    for(i = 0; i < aCount; ++ i)
+      aFunc((void *) ((char *) aArgs + i * aArgSize));
+    return;
+  }
+
+  // Start worker threads for all but the last task
+  for(i = 0; i < aCount; ++ i)
+  {
+    tasks[i].mFunc = aFunc;
+    tasks[i].mArg = (void *) ((char *) aArgs + i * aArgSize);
+    started[i] = CTM_FALSE;
+    if(i + 1 < aCount)
+    {
+#ifdef _WIN32
+      threads[i] = CreateThread(NULL, 0, _ctmThreadMain, (LPVOID) &tasks[i], 0, NULL);
+      started[i] = (threads[i] != NULL);
+#else
+      started[i] = (pthread_create(&threads[i], NULL, _ctmThreadMain, (void *) &tasks[i]) == 0);
+#endif
+    }
+  }
+
+  // Run the remaining tasks on this thread
+  for(i = 0; i < aCount; ++ i)
+  {
+    if(!started[i])
+      aFunc(tasks[i].mArg);
+  }
+
+  // Wait for the workers
+  for(i = 0; i < aCount; ++ i)
+  {
+    if(started[i])
+    {
+#ifdef _WIN32
+      WaitForSingleObject(threads[i], INFINITE);
+      CloseHandle(threads[i]);
+#else
+      pthread_join(threads[i], NULL);
+#endif
+    }
+  }
+
+  free((void *) threads);
+  free((void *) started);
+  free((void *) tasks);
+}
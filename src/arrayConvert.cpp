@@ -0,0 +1,138 @@
+#include "arrayConvert.h"
+
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+
+namespace seed
+{
+	namespace io
+	{
+		// writes a component given as float, already normalized when asked for
+		struct FloatWriter
+		{
+			float* out;
+			void operator()(float value) { *out++ = value; }
+		};
+
+		struct ByteWriter
+		{
+			unsigned char* out;
+			void operator()(float value) { *out++ = (unsigned char)(std::min(std::max(value, 0.0f), 1.0f) * 255.0f + 0.5f); }
+		};
+
+		template<typename ArrayT, typename Writer>
+		static void WriteElements(const osg::Array* array, size_t vertexCount, bool overall, int components, bool normalized, const osg::Vec3d* origin, Writer writer)
+		{
+			typedef typename ArrayT::ElementDataType ElementT;
+			typedef typename ElementT::value_type ValueT;
+			const int elementComponents = ElementT::num_components;
+			float scale = 1.0f;
+			if (normalized && std::is_integral<ValueT>::value)
+			{
+				scale = 1.0f / (float)std::numeric_limits<ValueT>::max();
+			}
+
+			const ArrayT& elements = *static_cast<const ArrayT*>(array);
+			if (origin)
+			{
+				for (size_t i = 0; i < vertexCount; ++i)
+				{
+					const ElementT& element = elements[overall ? 0 : i];
+					for (int c = 0; c < components; ++c)
+					{
+						writer(c < elementComponents ? (float)((double)element[c] - (c < 3 ? (*origin)[c] : 0.0)) : 0.0f);
+					}
+				}
+				return;
+			}
+			for (size_t i = 0; i < vertexCount; ++i)
+			{
+				const ElementT& element = elements[overall ? 0 : i];
+				for (int c = 0; c < components; ++c)
+				{
+					// missing components default like GL: z = 0, w = 1
+					writer(c < elementComponents ? (float)element[c] * scale : (c == 3 ? 1.0f : 0.0f));
+				}
+			}
+		}
+
+		template<typename Writer>
+		static bool DispatchArray(const osg::Array* array, size_t vertexCount, bool overall, int components, bool normalized, const osg::Vec3d* origin, Writer writer)
+		{
+			switch (array->getType())
+			{
+			case osg::Array::Vec2ArrayType: WriteElements<osg::Vec2Array>(array, vertexCount, overall, components, normalized, origin, writer); return true;
+			case osg::Array::Vec3ArrayType: WriteElements<osg::Vec3Array>(array, vertexCount, overall, components, normalized, origin, writer); return true;
+			case osg::Array::Vec4ArrayType: WriteElements<osg::Vec4Array>(array, vertexCount, overall, components, normalized, origin, writer); return true;
+			case osg::Array::Vec2dArrayType: WriteElements<osg::Vec2dArray>(array, vertexCount, overall, components, normalized, origin, writer); return true;
+			case osg::Array::Vec3dArrayType: WriteElements<osg::Vec3dArray>(array, vertexCount, overall, components, normalized, origin, writer); return true;
+			case osg::Array::Vec4dArrayType: WriteElements<osg::Vec4dArray>(array, vertexCount, overall, components, normalized, origin, writer); return true;
+			case osg::Array::Vec2bArrayType: WriteElements<osg::Vec2bArray>(array, vertexCount, overall, components, normalized, origin, writer); return true;
+			case osg::Array::Vec3bArrayType: WriteElements<osg::Vec3bArray>(array, vertexCount, overall, components, normalized, origin, writer); return true;
+			case osg::Array::Vec4bArrayType: WriteElements<osg::Vec4bArray>(array, vertexCount, overall, components, normalized, origin, writer); return true;
+			case osg::Array::Vec2sArrayType: WriteElements<osg::Vec2sArray>(array, vertexCount, overall, components, normalized, origin, writer); return true;
+			case osg::Array::Vec3sArrayType: WriteElements<osg::Vec3sArray>(array, vertexCount, overall, components, normalized, origin, writer); return true;
+			case osg::Array::Vec4sArrayType: WriteElements<osg::Vec4sArray>(array, vertexCount, overall, components, normalized, origin, writer); return true;
+			case osg::Array::Vec2ubArrayType: WriteElements<osg::Vec2ubArray>(array, vertexCount, overall, components, normalized, origin, writer); return true;
+			case osg::Array::Vec3ubArrayType: WriteElements<osg::Vec3ubArray>(array, vertexCount, overall, components, normalized, origin, writer); return true;
+			case osg::Array::Vec4ubArrayType: WriteElements<osg::Vec4ubArray>(array, vertexCount, overall, components, normalized, origin, writer); return true;
+			case osg::Array::Vec2usArrayType: WriteElements<osg::Vec2usArray>(array, vertexCount, overall, components, normalized, origin, writer); return true;
+			case osg::Array::Vec3usArrayType: WriteElements<osg::Vec3usArray>(array, vertexCount, overall, components, normalized, origin, writer); return true;
+			case osg::Array::Vec4usArrayType: WriteElements<osg::Vec4usArray>(array, vertexCount, overall, components, normalized, origin, writer); return true;
+			default: return false;
+			}
+		}
+
+		static bool IsSupportedBinding(const osg::Array* array, size_t vertexCount, bool& overall)
+		{
+			if (!array || array->getNumElements() == 0 || vertexCount == 0)
+				return false;
+			switch (array->getBinding())
+			{
+			case osg::Array::BIND_OVERALL:
+				overall = true;
+				return true;
+			case osg::Array::BIND_PER_VERTEX:
+				overall = false;
+				return array->getNumElements() == vertexCount;
+			case osg::Array::BIND_UNDEFINED:
+				// unset binding is taken from the element count
+				overall = array->getNumElements() != vertexCount;
+				return array->getNumElements() == vertexCount || array->getNumElements() == 1;
+			default:
+				return false;
+			}
+		}
+
+		bool ConvertArray(const osg::Array* array, size_t vertexCount, int components, bool normalized, std::vector<float>& out, const osg::Vec3d* origin)
+		{
+			bool overall = false;
+			if (!IsSupportedBinding(array, vertexCount, overall))
+				return false;
+			size_t offset = out.size();
+			out.resize(offset + vertexCount * components);
+			if (!DispatchArray(array, vertexCount, overall, components, normalized, origin, FloatWriter{ out.data() + offset }))
+			{
+				out.resize(offset);
+				return false;
+			}
+			return true;
+		}
+
+		bool ConvertColorArray(const osg::Array* array, size_t vertexCount, std::vector<unsigned char>& out)
+		{
+			bool overall = false;
+			if (!IsSupportedBinding(array, vertexCount, overall))
+				return false;
+			size_t offset = out.size();
+			out.resize(offset + vertexCount * 4);
+			if (!DispatchArray(array, vertexCount, overall, 4, true, nullptr, ByteWriter{ out.data() + offset }))
+			{
+				out.resize(offset);
+				return false;
+			}
+			return true;
+		}
+	}
+}
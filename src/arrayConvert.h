@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+
+#include <osg/Array>
+#include <osg/Vec3d>
+
+namespace seed
+{
+	namespace io
+	{
+		// Convert an osg vertex attribute array of any common element type (float, double, byte,
+		// short, unsigned byte and unsigned short vectors) to vertexCount elements of components
+		// floats, appended to out in a single pass. Integer components are mapped to [-1, 1] or
+		// [0, 1] when normalized, the way GL reads normals and colors. Per-vertex arrays must have
+		// vertexCount elements, an overall bound array is repeated for every vertex.
+		// When given, origin is subtracted in double precision before the cast to float.
+		// Returns false, leaving out untouched, for other types or bindings.
+		bool ConvertArray(const osg::Array* array, size_t vertexCount, int components, bool normalized, std::vector<float>& out, const osg::Vec3d* origin = nullptr);
+
+		// same, to rgba bytes (missing alpha is opaque)
+		bool ConvertColorArray(const osg::Array* array, size_t vertexCount, std::vector<unsigned char>& out);
+	}
+}
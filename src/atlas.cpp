@@ -0,0 +1,134 @@
+#include "atlas.h"
+
+#include <algorithm>
+#include <numeric>
+
+namespace seed
+{
+	namespace io
+	{
+		static bool PlaceOnShelves(const std::vector<const Image*>& images, const std::vector<int>& order, int size, int padding, std::vector<AtlasRect>& rects)
+		{
+			int x = 0, y = 0, shelfHeight = 0;
+			for (int i : order)
+			{
+				int w = images[i]->width + padding * 2;
+				int h = images[i]->height + padding * 2;
+				if (w > size)
+				{
+					return false;
+				}
+				if (x + w > size)
+				{
+					y += shelfHeight;
+					x = 0;
+					shelfHeight = 0;
+				}
+				if (y + h > size)
+				{
+					return false;
+				}
+				rects[i].x = x + padding;
+				rects[i].y = y + padding;
+				rects[i].width = images[i]->width;
+				rects[i].height = images[i]->height;
+				x += w;
+				shelfHeight = std::max(shelfHeight, h);
+			}
+			return true;
+		}
+
+		int ShelfPack(const std::vector<const Image*>& images, int maxSize, int padding, std::vector<AtlasRect>& rects)
+		{
+			if (images.empty())
+			{
+				return 0;
+			}
+
+			std::vector<int> order(images.size());
+			std::iota(order.begin(), order.end(), 0);
+			std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return images[a]->height > images[b]->height; });
+
+			size_t area = 0;
+			for (auto image : images)
+			{
+				area += (size_t)(image->width + padding * 2) * (image->height + padding * 2);
+			}
+
+			rects.assign(images.size(), AtlasRect());
+			int size = 1;
+			while ((size_t)size * size < area)
+			{
+				size *= 2;
+			}
+			for (; size <= maxSize; size *= 2)
+			{
+				if (PlaceOnShelves(images, order, size, padding, rects))
+				{
+					return size;
+				}
+			}
+			return 0;
+		}
+
+		void ComposeAtlas(const std::vector<const Image*>& images, const std::vector<AtlasRect>& rects, int size, int padding, Image& atlas)
+		{
+			int comp = 1;
+			for (auto image : images)
+			{
+				comp = std::max(comp, image->comp);
+			}
+
+			atlas = Image();
+			atlas.width = size;
+			atlas.height = size;
+			atlas.comp = comp;
+			atlas.pixels.assign((size_t)size * size * comp, 0);
+			for (size_t i = 0; i < images.size(); ++i)
+			{
+				const Image& image = *images[i];
+				const AtlasRect& rect = rects[i];
+				for (int y = rect.y - padding; y < rect.y + rect.height + padding; ++y)
+				{
+					int sy = std::min(std::max(y - rect.y, 0), image.height - 1);
+					for (int x = rect.x - padding; x < rect.x + rect.width + padding; ++x)
+					{
+						int sx = std::min(std::max(x - rect.x, 0), image.width - 1);
+						const unsigned char* src = &image.pixels[((size_t)sy * image.width + sx) * image.comp];
+						unsigned char* dst = &atlas.pixels[((size_t)y * size + x) * comp];
+						for (int c = 0; c < comp; ++c)
+						{
+							if (c < 3)
+							{
+								dst[c] = src[image.comp < 3 ? 0 : c];
+							}
+							else
+							{
+								dst[c] = image.comp == 4 ? src[3] : 255;
+							}
+						}
+					}
+				}
+			}
+		}
+
+		bool PackAtlas(const std::vector<const Image*>& images, int maxSize, int padding, Image& atlas, std::vector<AtlasRect>& rects)
+		{
+			int size = ShelfPack(images, maxSize, padding, rects);
+			if (size == 0)
+			{
+				return false;
+			}
+			ComposeAtlas(images, rects, size, padding, atlas);
+			return true;
+		}
+
+		void RemapUV(const AtlasRect& rect, int atlasWidth, int atlasHeight, float& u, float& v)
+		{
+			float s = std::min(std::max(u, 0.0f), 1.0f);
+			float t = std::min(std::max(v, 0.0f), 1.0f);
+			u = (rect.x + s * rect.width) / atlasWidth;
+			v = 1.0f - (rect.y + (1.0f - t) * rect.height) / atlasHeight;
+		}
+	}
+}
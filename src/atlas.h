@@ -0,0 +1,33 @@
+#pragma once
+
+#include "model.h"
+
+namespace seed
+{
+	namespace io
+	{
+		// placement of a packed image in an atlas, in pixels from the top left corner
+		struct AtlasRect
+		{
+			int x = 0;
+			int y = 0;
+			int width = 0;
+			int height = 0;
+		};
+
+		// Place the images on shelves, tallest first, in the smallest power-of-two square of at
+		// most maxSize pixels per side, leaving a border of padding pixels around each. Only the
+		// sizes of the images are read. Returns the side of the square, 0 if they do not fit.
+		int ShelfPack(const std::vector<const Image*>& images, int maxSize, int padding, std::vector<AtlasRect>& rects);
+
+		// Copy the images to their rects of a new size x size atlas, with a border of padding
+		// pixels repeating their edge so that filtering does not bleed.
+		void ComposeAtlas(const std::vector<const Image*>& images, const std::vector<AtlasRect>& rects, int size, int padding, Image& atlas);
+
+		// ShelfPack then ComposeAtlas, false if the images do not fit
+		bool PackAtlas(const std::vector<const Image*>& images, int maxSize, int padding, Image& atlas, std::vector<AtlasRect>& rects);
+
+		// map a uv of an image packed at rect to the atlas, uv origin is the bottom left corner
+		void RemapUV(const AtlasRect& rect, int atlasWidth, int atlasHeight, float& u, float& v);
+	}
+}
@@ -0,0 +1,202 @@
+#include "coarseLod.h"
+#include "common.h"
+#include "atlas.h"
+#include "encoder.h"
+#include "simplify.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+
+namespace seed
+{
+	namespace io
+	{
+		bool BuildProxy(const std::vector<const Mesh*>& meshes, const std::vector<const Image*>& textures, int atlasSize, size_t maxTriangles, Proxy& proxy)
+		{
+			// plain grey for meshes without texture or uv
+			Image grey;
+			grey.width = grey.height = 4;
+			grey.comp = 3;
+			grey.pixels.assign(grey.width * grey.height * grey.comp, 128);
+
+			std::vector<const Image*> images;
+			std::map<const Image*, int> imageIndex;
+			std::vector<int> meshImage(meshes.size());
+			for (size_t i = 0; i < meshes.size(); ++i)
+			{
+				const Image* image = textures[i];
+				if (!image || image->pixels.empty() || meshes[i]->uvs.size() != meshes[i]->vertices.size() / 3 * 2)
+				{
+					image = &grey;
+				}
+				auto found = imageIndex.find(image);
+				if (found == imageIndex.end())
+				{
+					found = imageIndex.insert(std::make_pair(image, (int)images.size())).first;
+					images.push_back(image);
+				}
+				meshImage[i] = found->second;
+			}
+			if (images.empty())
+			{
+				return false;
+			}
+
+			// halve every texture until the set fits
+			const int padding = 2;
+			std::vector<Image> scaled(images.size());
+			std::vector<const Image*> scaledPtrs(images.size());
+			for (size_t i = 0; i < images.size(); ++i)
+			{
+				// a copy even when it fits, it may be shrunk below
+				if (!DownsampleImage(*images[i], atlasSize - padding * 2, scaled[i]))
+				{
+					scaled[i] = *images[i];
+				}
+				scaledPtrs[i] = &scaled[i];
+			}
+			std::vector<AtlasRect> rects;
+			while (!PackAtlas(scaledPtrs, atlasSize, padding, proxy.image, rects))
+			{
+				bool shrunk = false;
+				for (auto& image : scaled)
+				{
+					int size = std::max(image.width, image.height);
+					if (size > 1)
+					{
+						Image half;
+						if (DownsampleImage(image, size / 2, half))
+						{
+							image = std::move(half);
+							shrunk = true;
+						}
+					}
+				}
+				if (!shrunk)
+				{
+					return false;
+				}
+			}
+
+			Mesh& merged = proxy.mesh;
+			merged = Mesh();
+			merged.origin = meshes.empty() ? osg::Vec3d(0, 0, 0) : meshes[0]->origin;
+			proxy.bb.init();
+			for (size_t i = 0; i < meshes.size(); ++i)
+			{
+				const Mesh& mesh = *meshes[i];
+				size_t vertexCount = mesh.vertices.size() / 3;
+				unsigned int base = (unsigned int)(merged.vertices.size() / 3);
+				const AtlasRect& rect = rects[meshImage[i]];
+				bool textured = images[meshImage[i]] != &grey;
+				osg::Vec3d shift = mesh.origin - merged.origin;
+				for (size_t v = 0; v < vertexCount; ++v)
+				{
+					float u = textured ? mesh.uvs[v * 2] : 0.5f;
+					float t = textured ? mesh.uvs[v * 2 + 1] : 0.5f;
+					RemapUV(rect, proxy.image.width, proxy.image.height, u, t);
+					merged.uvs.push_back(u);
+					merged.uvs.push_back(t);
+					osg::Vec3d position(mesh.vertices[v * 3] + shift.x(), mesh.vertices[v * 3 + 1] + shift.y(), mesh.vertices[v * 3 + 2] + shift.z());
+					merged.vertices.push_back((float)position.x());
+					merged.vertices.push_back((float)position.y());
+					merged.vertices.push_back((float)position.z());
+					proxy.bb.expandBy(position + merged.origin);
+				}
+				for (auto index : mesh.indices)
+				{
+					merged.indices.push_back(base + index);
+				}
+			}
+			if (merged.indices.empty())
+			{
+				return false;
+			}
+
+			SimplifyMesh(merged, maxTriangles);
+			return true;
+		}
+
+		static const char ProxyMagic[4] = { 'P', 'R', 'X', '1' };
+
+		template<typename T>
+		static void WriteArray(std::ofstream& outfile, const std::vector<T>& values)
+		{
+			uint64_t count = values.size();
+			outfile.write((const char*)&count, sizeof(count));
+			outfile.write((const char*)values.data(), sizeof(T) * values.size());
+		}
+
+		template<typename T>
+		static bool ReadArray(std::ifstream& infile, std::vector<T>& values)
+		{
+			uint64_t count = 0;
+			if (!infile.read((char*)&count, sizeof(count)) || count > (1ull << 32))
+				return false;
+			values.resize((size_t)count);
+			return (bool)infile.read((char*)values.data(), sizeof(T) * values.size());
+		}
+
+		bool SaveProxy(const Proxy& proxy, const std::string& path)
+		{
+			std::ofstream outfile(path, std::ios::out | std::ios::binary);
+			if (!outfile)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", path.c_str());
+				return false;
+			}
+			const Mesh& mesh = proxy.mesh;
+			outfile.write(ProxyMagic, sizeof(ProxyMagic));
+			WriteArray(outfile, mesh.vertices);
+			WriteArray(outfile, mesh.normals);
+			WriteArray(outfile, mesh.uvs);
+			WriteArray(outfile, mesh.colors);
+			WriteArray(outfile, mesh.indices);
+			double origin[3] = { mesh.origin.x(), mesh.origin.y(), mesh.origin.z() };
+			outfile.write((const char*)origin, sizeof(origin));
+			int32_t image[3] = { proxy.image.width, proxy.image.height, proxy.image.comp };
+			outfile.write((const char*)image, sizeof(image));
+			WriteArray(outfile, proxy.image.pixels);
+			float bb[6] = { proxy.bb.xMin(), proxy.bb.yMin(), proxy.bb.zMin(), proxy.bb.xMax(), proxy.bb.yMax(), proxy.bb.zMax() };
+			outfile.write((const char*)bb, sizeof(bb));
+			if (!outfile)
+			{
+				seed::log::DumpLog(seed::log::Critical, "An error has occurred while writing file %s!", path.c_str());
+				return false;
+			}
+			return true;
+		}
+
+		bool LoadProxy(const std::string& path, Proxy& proxy)
+		{
+			std::ifstream infile(path, std::ios::in | std::ios::binary);
+			char magic[4];
+			if (!infile.read(magic, sizeof(magic)) || memcmp(magic, ProxyMagic, sizeof(magic)) != 0)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Invalid proxy file %s!", path.c_str());
+				return false;
+			}
+			Mesh& mesh = proxy.mesh;
+			double origin[3];
+			int32_t image[3];
+			float bb[6];
+			if (!ReadArray(infile, mesh.vertices) || !ReadArray(infile, mesh.normals) || !ReadArray(infile, mesh.uvs)
+				|| !ReadArray(infile, mesh.colors) || !ReadArray(infile, mesh.indices)
+				|| !infile.read((char*)origin, sizeof(origin)) || !infile.read((char*)image, sizeof(image))
+				|| !ReadArray(infile, proxy.image.pixels) || !infile.read((char*)bb, sizeof(bb)))
+			{
+				seed::log::DumpLog(seed::log::Critical, "Invalid proxy file %s!", path.c_str());
+				return false;
+			}
+			mesh.origin = osg::Vec3d(origin[0], origin[1], origin[2]);
+			proxy.image.width = image[0];
+			proxy.image.height = image[1];
+			proxy.image.comp = image[2];
+			proxy.bb = osg::BoundingBox(bb[0], bb[1], bb[2], bb[3], bb[4], bb[5]);
+			return true;
+		}
+	}
+}
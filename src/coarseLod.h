@@ -0,0 +1,26 @@
+#pragma once
+
+#include "model.h"
+
+namespace seed
+{
+	namespace io
+	{
+		// merged, decimated stand-in for a subtree, with its textures packed into one atlas
+		struct Proxy
+		{
+			Mesh mesh;
+			Image image;
+			osg::BoundingBox bb;
+		};
+
+		// Merge the meshes (textures[i] is the texture of meshes[i], or nullptr) into one mesh
+		// whose uv point into an atlas of at most atlasSize pixels per side, then decimate it to
+		// maxTriangles. Textures are halved until they all fit into the atlas.
+		bool BuildProxy(const std::vector<const Mesh*>& meshes, const std::vector<const Image*>& textures, int atlasSize, size_t maxTriangles, Proxy& proxy);
+
+		// raw binary copy of a proxy, handed over between the processes of a distributed conversion
+		bool SaveProxy(const Proxy& proxy, const std::string& path);
+		bool LoadProxy(const std::string& path, Proxy& proxy);
+	}
+}
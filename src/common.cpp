@@ -130,5 +130,12 @@ namespace seed
 		{
 			return std::experimental::filesystem::exists(i_strPath);
 		}
+
+		unsigned long long FileSize(const std::string& i_strPath)
+		{
+			std::error_code ec;
+			auto size = std::experimental::filesystem::file_size(i_strPath, ec);
+			return ec ? 0 : (unsigned long long)size;
+		}
 	}
 }
\ No newline at end of file
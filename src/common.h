@@ -32,5 +32,6 @@ namespace seed
 	{
 		bool CheckOrCreateFolder(const std::string& i_strDir);
 		bool FileExists(const std::string& i_strPath);
+		unsigned long long FileSize(const std::string& i_strPath); // 0 if missing
 	}
 }
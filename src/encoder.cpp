@@ -0,0 +1,143 @@
+#include "encoder.h"
+#include "common.h"
+
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb_image_write.h"
+#include "openctm.h"
+
+#include <algorithm>
+
+namespace seed
+{
+	namespace io
+	{
+		void write_buf(void* context, void* data, int len) {
+			std::vector<char>* buf = (std::vector<char>*)context;
+			buf->insert(buf->end(), (char*)data, (char*)data + len);
+		}
+
+		static CTMuint CTMCALL _ctm_write_buf(const void * aBuf, CTMuint aCount, void * aUserData)
+		{
+			std::vector<char>* buf = (std::vector<char>*)aUserData;
+			buf->insert(buf->end(), (char*)aBuf, (char*)aBuf + aCount);
+			return aCount;
+		}
+
+		// 3mx has no per resource transform: add the local origin back
+		static const float* AbsoluteVertices(const Mesh& mesh, std::vector<float>& absolute)
+		{
+			if (mesh.origin == osg::Vec3d(0, 0, 0))
+			{
+				return mesh.vertices.data();
+			}
+			absolute.resize(mesh.vertices.size());
+			for (size_t i = 0; i < mesh.vertices.size(); ++i)
+			{
+				absolute[i] = (float)(mesh.vertices[i] + mesh.origin[i % 3]);
+			}
+			return absolute.data();
+		}
+
+		bool EncodeMeshToCtm(const Mesh& mesh, std::vector<char>& bufferData, bool withUVs, const CtmPrecision& precision, bool parallel)
+		{
+			size_t vertexCount = mesh.vertices.size() / 3;
+			if (vertexCount == 0 || mesh.indices.size() < 3)
+			{
+				return false;
+			}
+			try
+			{
+				std::vector<float> absolute;
+				CTMexporter ctm;
+				ctm.DefineMesh(AbsoluteVertices(mesh, absolute), (CTMuint)vertexCount, mesh.indices.data(), (CTMuint)(mesh.indices.size() / 3),
+					mesh.normals.size() == vertexCount * 3 ? mesh.normals.data() : nullptr);
+				if (withUVs && mesh.uvs.size() == vertexCount * 2)
+				{
+					ctm.AddUVMap(mesh.uvs.data(), nullptr, nullptr);
+				}
+				if (precision.vertex > 0 || precision.vertexRel > 0)
+				{
+					ctm.CompressionMethod(CTM_METHOD_MG2);
+					if (precision.vertex > 0)
+						ctm.VertexPrecision(precision.vertex);
+					else
+						ctm.VertexPrecisionRel(precision.vertexRel);
+				}
+				ctm.ParallelPacking(parallel);
+				ctm.SaveCustom(_ctm_write_buf, &bufferData);
+			}
+			catch (const ctm_error& e)
+			{
+				seed::log::DumpLog(seed::log::Critical, "OpenCTM error: %s", e.what());
+				return false;
+			}
+			return true;
+		}
+
+		bool EncodeMeshToXyz(const Mesh& mesh, std::vector<char>& bufferData)
+		{
+			int vec_size = (int)(mesh.vertices.size() / 3);
+			if (vec_size == 0) {
+				return false;
+			}
+			if (mesh.colors.size() != (size_t)vec_size * 4) {
+				return false;
+			}
+
+			std::vector<float> absolute;
+			const float* vertices = AbsoluteVertices(mesh, absolute);
+			bufferData.insert(bufferData.end(), (char*)&vec_size, (char*)&vec_size + 4);
+			bufferData.insert(bufferData.end(), (char*)vertices, (char*)vertices + sizeof(float) * mesh.vertices.size());
+			bufferData.insert(bufferData.end(), (char*)mesh.colors.data(), (char*)mesh.colors.data() + sizeof(char) * mesh.colors.size());
+			return true;
+		}
+
+		bool DownsampleImage(const Image& image, int maxSize, Image& downsampled)
+		{
+			if (maxSize <= 0 || image.pixels.empty() || (image.width <= maxSize && image.height <= maxSize))
+			{
+				return false;
+			}
+			// the first pass reads the source image, the next ones the previous pass
+			const Image* src = &image;
+			while (src->width > maxSize || src->height > maxSize)
+			{
+				Image half;
+				half.width = std::max(1, src->width / 2);
+				half.height = std::max(1, src->height / 2);
+				half.comp = src->comp;
+				half.pixels.resize(half.width * half.height * half.comp);
+				for (int y = 0; y < half.height; ++y)
+				{
+					int y0 = std::min(y * 2, src->height - 1);
+					int y1 = std::min(y * 2 + 1, src->height - 1);
+					for (int x = 0; x < half.width; ++x)
+					{
+						int x0 = std::min(x * 2, src->width - 1);
+						int x1 = std::min(x * 2 + 1, src->width - 1);
+						for (int c = 0; c < src->comp; ++c)
+						{
+							int sum = src->pixels[(y0 * src->width + x0) * src->comp + c] + src->pixels[(y0 * src->width + x1) * src->comp + c]
+								+ src->pixels[(y1 * src->width + x0) * src->comp + c] + src->pixels[(y1 * src->width + x1) * src->comp + c];
+							half.pixels[(y * half.width + x) * half.comp + c] = (unsigned char)((sum + 2) / 4);
+						}
+					}
+				}
+				downsampled = std::move(half);
+				src = &downsampled;
+			}
+			return true;
+		}
+
+		bool EncodeImageToJpeg(const Image& image, std::vector<char>& bufferData, int quality)
+		{
+			if (image.pixels.empty())
+			{
+				return false;
+			}
+			bufferData.reserve(image.width * image.height * image.comp);
+			return stbi_write_jpg_to_func(write_buf, &bufferData, image.width, image.height, image.comp, image.pixels.data(), quality) != 0;
+		}
+	}
+}
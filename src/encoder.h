@@ -0,0 +1,30 @@
+#pragma once
+
+#include "model.h"
+
+namespace seed
+{
+	namespace io
+	{
+		// MG2 vertex quantization of a ctm geometry
+		struct CtmPrecision
+		{
+			float vertex = 0;		// absolute grid step, 0: relative
+			float vertexRel = 0;	// step relative to the average edge length, 0 with vertex 0: lossless MG1
+		};
+
+		// geometryBuffer "ctm": OpenCTM tri-mesh with optional normals and uv, positions in absolute coordinates
+		// parallel: compress the streams of a large mesh on one thread each, when nothing else runs
+		bool EncodeMeshToCtm(const Mesh& mesh, std::vector<char>& bufferData, bool withUVs = true, const CtmPrecision& precision = CtmPrecision(), bool parallel = false);
+
+		// geometryBuffer "xyz": point count, xyz floats, rgba bytes
+		bool EncodeMeshToXyz(const Mesh& mesh, std::vector<char>& bufferData);
+
+		// halve the image with a box filter until neither side exceeds maxSize, false (and downsampled
+		// untouched) if it already fits: use the image itself then, it is not copied
+		bool DownsampleImage(const Image& image, int maxSize, Image& downsampled);
+
+		// textureBuffer "jpg"
+		bool EncodeImageToJpeg(const Image& image, std::vector<char>& bufferData, int quality = 80);
+	}
+}
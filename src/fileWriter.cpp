@@ -0,0 +1,180 @@
+#include "fileWriter.h"
+#include "common.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace seed
+{
+	namespace io
+	{
+#ifdef _WIN32
+		bool WriteWholeFile(const std::string& path, const std::vector<std::vector<char>>& buffers)
+		{
+			FILE* file = fopen(path.c_str(), "wb");
+			if (!file)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", path.c_str());
+				return false;
+			}
+			// unbuffered: each buffer goes to the file in one call, without a copy
+			setvbuf(file, nullptr, _IONBF, 0);
+			bool written = true;
+			for (const auto& buffer : buffers)
+			{
+				if (!buffer.empty() && fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+				{
+					written = false;
+					break;
+				}
+			}
+			if (fclose(file) != 0 || !written)
+			{
+				seed::log::DumpLog(seed::log::Critical, "An error has occurred while writing file %s!", path.c_str());
+				return false;
+			}
+			return true;
+		}
+#else
+		bool WriteWholeFile(const std::string& path, const std::vector<std::vector<char>>& buffers)
+		{
+			int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+			if (fd < 0)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", path.c_str());
+				return false;
+			}
+			std::vector<iovec> pieces;
+			size_t total = 0;
+			for (const auto& buffer : buffers)
+			{
+				if (!buffer.empty())
+				{
+					pieces.push_back({ (void*)buffer.data(), buffer.size() });
+					total += buffer.size();
+				}
+			}
+#ifdef POSIX_FADV_SEQUENTIAL
+			posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+			// writev may write less than asked: continue after the last byte written
+			bool written = true;
+			size_t first = 0;
+			while (first < pieces.size())
+			{
+				ssize_t count = writev(fd, &pieces[first], (int)std::min<size_t>(pieces.size() - first, IOV_MAX));
+				if (count < 0)
+				{
+					written = false;
+					break;
+				}
+				size_t left = (size_t)count;
+				while (first < pieces.size() && left >= pieces[first].iov_len)
+				{
+					left -= pieces[first].iov_len;
+					first++;
+				}
+				if (left)
+				{
+					pieces[first].iov_base = (char*)pieces[first].iov_base + left;
+					pieces[first].iov_len -= left;
+				}
+			}
+#ifdef POSIX_FADV_DONTNEED
+			if (written)
+			{
+				// starts the write back, and drops the pages already clean
+				posix_fadvise(fd, 0, (off_t)total, POSIX_FADV_DONTNEED);
+			}
+#endif
+			if (close(fd) != 0 || !written)
+			{
+				seed::log::DumpLog(seed::log::Critical, "An error has occurred while writing file %s!", path.c_str());
+				return false;
+			}
+			return true;
+		}
+#endif
+
+		FileWriter::FileWriter(const std::shared_ptr<Storage>& storage) : _storage(storage)
+		{
+			for (size_t i = 0; i < std::max<size_t>(1, _storage->Concurrency()); ++i)
+			{
+				_threads.emplace_back(&FileWriter::Run, this);
+			}
+		}
+
+		FileWriter::~FileWriter()
+		{
+			Flush();
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_stop = true;
+				_queued.notify_all();
+			}
+			for (auto& thread : _threads)
+			{
+				thread.join();
+			}
+		}
+
+		void FileWriter::Write(const std::string& path, std::vector<std::vector<char>>&& buffers)
+		{
+			Job job;
+			job.path = path;
+			job.buffers = std::move(buffers);
+			for (const auto& buffer : job.buffers)
+			{
+				job.bytes += buffer.size();
+			}
+			std::unique_lock<std::mutex> lock(_mutex);
+			// a file larger than the limit still goes through, alone
+			_written.wait(lock, [this, &job]() { return _pendingBytes == 0 || _pendingBytes + job.bytes <= MaxPendingBytes; });
+			_pendingBytes += job.bytes;
+			_jobs.push_back(std::move(job));
+			_queued.notify_one();
+		}
+
+		bool FileWriter::Flush()
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_written.wait(lock, [this]() { return _jobs.empty() && _running == 0; });
+			bool succeeded = !_failed && _storage->Sync();
+			_failed = false;
+			return succeeded;
+		}
+
+		void FileWriter::Run()
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			while (true)
+			{
+				_queued.wait(lock, [this]() { return _stop || !_jobs.empty(); });
+				if (_jobs.empty())
+				{
+					return;
+				}
+				Job job = std::move(_jobs.front());
+				_jobs.pop_front();
+				_running++;
+				lock.unlock();
+
+				bool written = _storage->Write(job.path, job.buffers);
+				job.buffers.clear();
+
+				lock.lock();
+				_running--;
+				_pendingBytes -= job.bytes;
+				_failed = _failed || !written;
+				_written.notify_all();
+			}
+		}
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "storage.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace seed
+{
+	namespace io
+	{
+		// Write the buffers one after the other to a new file, with one open and as few write
+		// calls as the platform allows (a single writev on POSIX). The written pages are dropped
+		// from the file cache, the output is not read again by the conversion.
+		bool WriteWholeFile(const std::string& path, const std::vector<std::vector<char>>& buffers);
+
+		// Writes whole files to a storage on its number of background threads, so that encoding
+		// threads do not wait on the file system or the network. Write takes the buffers and returns
+		// at once unless MaxPendingBytes are already waiting to be written. Errors are logged and
+		// reported by the next Flush. The default storage takes absolute paths.
+		class FileWriter
+		{
+		public:
+			FileWriter(const std::shared_ptr<Storage>& storage = std::make_shared<LocalStorage>(""));
+			~FileWriter();
+
+			void Write(const std::string& path, std::vector<std::vector<char>>&& buffers);
+
+			// waits until every file submitted so far is written, false if any write failed since
+			// the previous Flush
+			bool Flush();
+
+		private:
+			void Run();
+
+			struct Job
+			{
+				std::string path;
+				std::vector<std::vector<char>> buffers;
+				unsigned long long bytes = 0;
+			};
+
+			static const unsigned long long MaxPendingBytes = 256ull << 20;
+
+			std::mutex _mutex;
+			std::condition_variable _queued;
+			std::condition_variable _written;
+			std::deque<Job> _jobs;
+			unsigned long long _pendingBytes = 0;
+			size_t _running = 0;
+			bool _failed = false;
+			bool _stop = false;
+			std::vector<std::thread> _threads;
+			std::shared_ptr<Storage> _storage;
+		};
+	}
+}
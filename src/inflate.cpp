@@ -0,0 +1,314 @@
+#include "inflate.h"
+
+namespace seed
+{
+	namespace io
+	{
+		namespace
+		{
+			// canonical Huffman code: number of codes per length, and the symbols ordered by code
+			struct Huffman
+			{
+				unsigned short counts[16];
+				unsigned short symbols[288];
+			};
+
+			const unsigned short LengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+			const unsigned short LengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+			const unsigned short DistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+			const unsigned short DistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+			class Inflater
+			{
+			public:
+				Inflater(const unsigned char* data, size_t size, std::vector<char>& out) : _data(data), _size(size), _out(out) {}
+
+				bool Run()
+				{
+					int last = 0;
+					do
+					{
+						last = Bits(1);
+						int type = Bits(2);
+						bool decoded = false;
+						if (type == 0)
+						{
+							decoded = Stored();
+						}
+						else if (type == 1)
+						{
+							decoded = Fixed();
+						}
+						else if (type == 2)
+						{
+							decoded = Dynamic();
+						}
+						if (!decoded || _overrun)
+						{
+							return false;
+						}
+					} while (!last);
+					return true;
+				}
+
+			private:
+				// bits are packed from the least significant bit of each byte
+				int Bits(int count)
+				{
+					while (_bitCount < count)
+					{
+						if (_pos == _size)
+						{
+							_overrun = true;
+							return 0;
+						}
+						_bitBuffer |= (unsigned int)_data[_pos++] << _bitCount;
+						_bitCount += 8;
+					}
+					int value = (int)(_bitBuffer & ((1u << count) - 1));
+					_bitBuffer >>= count;
+					_bitCount -= count;
+					return value;
+				}
+
+				// -1 if lengths over-subscribe the code
+				static int Build(Huffman& huffman, const unsigned char* lengths, int count)
+				{
+					for (int len = 0; len < 16; ++len)
+					{
+						huffman.counts[len] = 0;
+					}
+					for (int symbol = 0; symbol < count; ++symbol)
+					{
+						huffman.counts[lengths[symbol]]++;
+					}
+					if (huffman.counts[0] == count)
+					{
+						return 0;
+					}
+					int left = 1;
+					for (int len = 1; len < 16; ++len)
+					{
+						left <<= 1;
+						left -= huffman.counts[len];
+						if (left < 0)
+						{
+							return -1;
+						}
+					}
+					unsigned short offsets[16];
+					offsets[1] = 0;
+					for (int len = 1; len < 15; ++len)
+					{
+						offsets[len + 1] = offsets[len] + huffman.counts[len];
+					}
+					for (int symbol = 0; symbol < count; ++symbol)
+					{
+						if (lengths[symbol])
+						{
+							huffman.symbols[offsets[lengths[symbol]]++] = (unsigned short)symbol;
+						}
+					}
+					return left;
+				}
+
+				// codes are read from their most significant bit, one bit at a time
+				int Decode(const Huffman& huffman)
+				{
+					int code = 0, first = 0, index = 0;
+					for (int len = 1; len < 16; ++len)
+					{
+						code |= Bits(1);
+						int count = huffman.counts[len];
+						if (code - first < count)
+						{
+							return huffman.symbols[index + (code - first)];
+						}
+						index += count;
+						first += count;
+						first <<= 1;
+						code <<= 1;
+					}
+					return -1;
+				}
+
+				bool Stored()
+				{
+					_bitBuffer = 0;
+					_bitCount = 0;
+					if (_pos + 4 > _size)
+					{
+						return false;
+					}
+					unsigned int length = _data[_pos] | (_data[_pos + 1] << 8);
+					unsigned int complement = _data[_pos + 2] | (_data[_pos + 3] << 8);
+					_pos += 4;
+					if (length != (~complement & 0xffff) || _pos + length > _size)
+					{
+						return false;
+					}
+					_out.insert(_out.end(), (const char*)_data + _pos, (const char*)_data + _pos + length);
+					_pos += length;
+					return true;
+				}
+
+				bool Codes(const Huffman& lengthCode, const Huffman& distanceCode)
+				{
+					while (!_overrun)
+					{
+						int symbol = Decode(lengthCode);
+						if (symbol < 0)
+						{
+							return false;
+						}
+						if (symbol < 256)
+						{
+							_out.push_back((char)symbol);
+							continue;
+						}
+						if (symbol == 256)
+						{
+							return true;
+						}
+						symbol -= 257;
+						if (symbol >= 29)
+						{
+							return false;
+						}
+						size_t length = LengthBase[symbol] + Bits(LengthExtra[symbol]);
+						int distanceSymbol = Decode(distanceCode);
+						if (distanceSymbol < 0 || distanceSymbol >= 30)
+						{
+							return false;
+						}
+						size_t distance = DistanceBase[distanceSymbol] + Bits(DistanceExtra[distanceSymbol]);
+						if (distance > _out.size())
+						{
+							return false;
+						}
+						// the copy may overlap what it appends
+						size_t from = _out.size() - distance;
+						for (size_t i = 0; i < length; ++i)
+						{
+							_out.push_back(_out[from + i]);
+						}
+					}
+					return false;
+				}
+
+				bool Fixed()
+				{
+					static Huffman lengthCode, distanceCode;
+					static bool built = [] {
+						unsigned char lengths[288];
+						int symbol = 0;
+						for (; symbol < 144; ++symbol) lengths[symbol] = 8;
+						for (; symbol < 256; ++symbol) lengths[symbol] = 9;
+						for (; symbol < 280; ++symbol) lengths[symbol] = 7;
+						for (; symbol < 288; ++symbol) lengths[symbol] = 8;
+						Build(lengthCode, lengths, 288);
+						for (symbol = 0; symbol < 30; ++symbol) lengths[symbol] = 5;
+						Build(distanceCode, lengths, 30);
+						return true;
+					}();
+					(void)built;
+					return Codes(lengthCode, distanceCode);
+				}
+
+				bool Dynamic()
+				{
+					static const unsigned char order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+					int lengthCount = Bits(5) + 257;
+					int distanceCount = Bits(5) + 1;
+					int codeCount = Bits(4) + 4;
+					if (lengthCount > 286 || distanceCount > 30)
+					{
+						return false;
+					}
+
+					unsigned char lengths[320] = { 0 };
+					for (int i = 0; i < codeCount; ++i)
+					{
+						lengths[order[i]] = (unsigned char)Bits(3);
+					}
+					Huffman lengthCode, distanceCode;
+					if (Build(lengthCode, lengths, 19) != 0)
+					{
+						return false;
+					}
+
+					int index = 0;
+					while (index < lengthCount + distanceCount)
+					{
+						int symbol = Decode(lengthCode);
+						if (symbol < 0 || _overrun)
+						{
+							return false;
+						}
+						if (symbol < 16)
+						{
+							lengths[index++] = (unsigned char)symbol;
+							continue;
+						}
+						unsigned char value = 0;
+						int repeat = 0;
+						if (symbol == 16)
+						{
+							if (index == 0)
+							{
+								return false;
+							}
+							value = lengths[index - 1];
+							repeat = 3 + Bits(2);
+						}
+						else if (symbol == 17)
+						{
+							repeat = 3 + Bits(3);
+						}
+						else
+						{
+							repeat = 11 + Bits(7);
+						}
+						if (index + repeat > lengthCount + distanceCount)
+						{
+							return false;
+						}
+						while (repeat--)
+						{
+							lengths[index++] = value;
+						}
+					}
+					if (lengths[256] == 0)
+					{
+						return false;
+					}
+					// incomplete codes are only allowed for a single length or distance code
+					int left = Build(lengthCode, lengths, lengthCount);
+					if (left < 0 || (left > 0 && lengthCount - lengthCode.counts[0] != 1))
+					{
+						return false;
+					}
+					left = Build(distanceCode, lengths + lengthCount, distanceCount);
+					if (left < 0 || (left > 0 && distanceCount - distanceCode.counts[0] != 1))
+					{
+						return false;
+					}
+					return Codes(lengthCode, distanceCode);
+				}
+
+				const unsigned char* _data;
+				size_t _size;
+				size_t _pos = 0;
+				unsigned int _bitBuffer = 0;
+				int _bitCount = 0;
+				bool _overrun = false;
+				std::vector<char>& _out;
+			};
+		}
+
+		bool Inflate(const unsigned char* data, size_t size, std::vector<char>& out)
+		{
+			return Inflater(data, size, out).Run();
+		}
+	}
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace seed
+{
+	namespace io
+	{
+		// Decode raw DEFLATE data (RFC 1951, the "deflate" method of zip members) and append it to
+		// out, false if the data is corrupt.
+		bool Inflate(const unsigned char* data, size_t size, std::vector<char>& out);
+	}
+}
@@ -0,0 +1,461 @@
+#include "inputArchive.h"
+#include "inflate.h"
+#include "common.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <set>
+#include <sstream>
+
+#include <osgDB/FileNameUtils>
+#include <osgDB/ReaderWriter>
+#include <osgDB/Registry>
+
+namespace seed
+{
+	namespace io
+	{
+		static unsigned int Get16(const unsigned char* p) { return p[0] | (p[1] << 8); }
+		static unsigned int Get32(const unsigned char* p) { return Get16(p) | ((unsigned int)Get16(p + 2) << 16); }
+		static unsigned long long Get64(const unsigned char* p) { return Get32(p) | ((unsigned long long)Get32(p + 4) << 32); }
+
+		// '/' separated, without leading "./" or "/"
+		static std::string NormalizePath(std::string path)
+		{
+			std::replace(path.begin(), path.end(), '\\', '/');
+			size_t start = 0;
+			while (start < path.size() && (path[start] == '/' || path.compare(start, 2, "./") == 0))
+			{
+				start += path[start] == '/' ? 1 : 2;
+			}
+			std::string normalized;
+			for (size_t i = start; i < path.size(); ++i)
+			{
+				if (path[i] != '/' || normalized.empty() || normalized.back() != '/')
+				{
+					normalized += path[i];
+				}
+			}
+			return normalized;
+		}
+
+		// decoders read the whole member from memory, and may seek in it
+		class MemoryBuffer : public std::streambuf
+		{
+		public:
+			MemoryBuffer(std::vector<char>& data) { setg(data.data(), data.data(), data.data() + data.size()); }
+
+		protected:
+			pos_type seekoff(off_type offset, std::ios_base::seekdir dir, std::ios_base::openmode) override
+			{
+				char* position = dir == std::ios_base::beg ? eback() + offset : dir == std::ios_base::cur ? gptr() + offset : egptr() + offset;
+				if (position < eback() || position > egptr())
+				{
+					return pos_type(off_type(-1));
+				}
+				setg(eback(), position, egptr());
+				return pos_type(position - eback());
+			}
+
+			pos_type seekpos(pos_type position, std::ios_base::openmode mode) override
+			{
+				return seekoff(off_type(position), std::ios_base::beg, mode);
+			}
+		};
+
+		bool InputArchive::IsArchive(const std::string& path)
+		{
+			std::string ext = osgDB::getLowerCaseFileExtension(path);
+			return (ext == "zip" || ext == "tar") && osgDB::fileType(path) == osgDB::REGULAR_FILE;
+		}
+
+		bool InputArchive::Open(const std::string& path)
+		{
+			_file = path;
+			_path = NormalizePath(path);
+			_zip = osgDB::getLowerCaseFileExtension(path) == "zip";
+			_members.clear();
+			std::ifstream archive(path, std::ios::in | std::ios::binary);
+			if (!archive)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", path.c_str());
+				return false;
+			}
+			std::map<std::string, Member> members;
+			if (!(_zip ? ReadZipDirectory(archive, members) : ReadTarHeaders(archive, members)))
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT read the members of %s!", path.c_str());
+				return false;
+			}
+
+			// the input folder may be archived itself: its path is whatever precedes Data/
+			std::string root;
+			bool found = false;
+			for (const auto& member : members)
+			{
+				const std::string& name = member.first;
+				size_t pos = name.compare(0, 5, "Data/") == 0 ? 0 : name.find("/Data/");
+				if (pos != std::string::npos)
+				{
+					root = pos == 0 ? "" : name.substr(0, pos + 1);
+					found = true;
+					break;
+				}
+			}
+			if (!found)
+			{
+				seed::log::DumpLog(seed::log::Critical, "No Data folder in %s!", path.c_str());
+				return false;
+			}
+			for (auto& member : members)
+			{
+				if (member.first.compare(0, root.size(), root) == 0)
+				{
+					// paths are built with a lower case .osgb, names in archives are case sensitive
+					std::string name = member.first.substr(root.size());
+					if (IsOsgbFile(name))
+					{
+						name.replace(name.size() - 5, 5, ".osgb");
+					}
+					_members[name] = member.second;
+				}
+			}
+			seed::log::DumpLog(seed::log::Info, "Reading %d files from %s", (int)_members.size(), path.c_str());
+			return true;
+		}
+
+		bool InputArchive::ReadZipDirectory(std::istream& archive, std::map<std::string, Member>& members)
+		{
+			// the end of central directory record, followed by a comment of up to 64 KB
+			archive.seekg(0, std::ios::end);
+			unsigned long long fileSize = (unsigned long long)archive.tellg();
+			size_t tailSize = (size_t)std::min<unsigned long long>(fileSize, 22 + 65535);
+			std::vector<unsigned char> tail(tailSize);
+			archive.seekg((std::streamoff)(fileSize - tailSize));
+			if (tailSize < 22 || !archive.read((char*)tail.data(), tailSize))
+			{
+				return false;
+			}
+			size_t end = tailSize - 22 + 1;
+			while (end-- > 0 && Get32(&tail[end]) != 0x06054b50)
+				;
+			if (end == (size_t)-1)
+			{
+				return false;
+			}
+			unsigned long long count = Get16(&tail[end + 10]);
+			unsigned long long directorySize = Get32(&tail[end + 12]);
+			unsigned long long directoryOffset = Get32(&tail[end + 16]);
+			if (count == 0xffff || directorySize == 0xffffffff || directoryOffset == 0xffffffff)
+			{
+				// zip64: the locator precedes the record, and points to the zip64 record
+				unsigned char locator[20], record[56];
+				unsigned long long locatorOffset = fileSize - tailSize + end - 20;
+				archive.seekg((std::streamoff)locatorOffset);
+				if (!archive.read((char*)locator, sizeof(locator)) || Get32(locator) != 0x07064b50)
+				{
+					return false;
+				}
+				archive.seekg((std::streamoff)Get64(locator + 8));
+				if (!archive.read((char*)record, sizeof(record)) || Get32(record) != 0x06064b50)
+				{
+					return false;
+				}
+				count = Get64(record + 32);
+				directorySize = Get64(record + 40);
+				directoryOffset = Get64(record + 48);
+			}
+
+			std::vector<unsigned char> directory((size_t)directorySize);
+			archive.seekg((std::streamoff)directoryOffset);
+			if (!archive.read((char*)directory.data(), directory.size()))
+			{
+				return false;
+			}
+			const unsigned char* p = directory.data();
+			const unsigned char* directoryEnd = p + directory.size();
+			for (unsigned long long i = 0; i < count; ++i)
+			{
+				if (p + 46 > directoryEnd || Get32(p) != 0x02014b50)
+				{
+					return false;
+				}
+				unsigned int nameLength = Get16(p + 28);
+				unsigned int extraLength = Get16(p + 30);
+				unsigned int commentLength = Get16(p + 32);
+				if (p + 46 + nameLength + extraLength + commentLength > directoryEnd)
+				{
+					return false;
+				}
+				Member member;
+				member.method = (Get16(p + 8) & 1) ? -1 : (int)Get16(p + 10);
+				member.packedSize = Get32(p + 20);
+				member.size = Get32(p + 24);
+				member.offset = Get32(p + 42);
+				std::string name((const char*)p + 46, nameLength);
+
+				// zip64 extra field: the 64 bit values of the fields set to 0xffffffff, in order
+				const unsigned char* extra = p + 46 + nameLength;
+				const unsigned char* extraEnd = extra + extraLength;
+				while (extra + 4 <= extraEnd)
+				{
+					unsigned int id = Get16(extra);
+					unsigned int size = Get16(extra + 2);
+					const unsigned char* value = extra + 4;
+					const unsigned char* valueEnd = std::min(value + size, extraEnd);
+					if (id == 1)
+					{
+						unsigned long long* fields[3] = { &member.size, &member.packedSize, &member.offset };
+						for (auto field : fields)
+						{
+							if (*field == 0xffffffff && value + 8 <= valueEnd)
+							{
+								*field = Get64(value);
+								value += 8;
+							}
+						}
+					}
+					extra += 4 + size;
+				}
+				p += 46 + nameLength + extraLength + commentLength;
+
+				name = NormalizePath(name);
+				if (!name.empty() && name.back() != '/')
+				{
+					members[name] = member;
+				}
+			}
+			return true;
+		}
+
+		static unsigned long long TarNumber(const char* field, size_t size)
+		{
+			// base-256 for sizes of 8 GB or more, else octal
+			if ((unsigned char)field[0] & 0x80)
+			{
+				unsigned long long value = (unsigned char)field[0] & 0x7f;
+				for (size_t i = 1; i < size; ++i)
+				{
+					value = (value << 8) | (unsigned char)field[i];
+				}
+				return value;
+			}
+			unsigned long long value = 0;
+			for (size_t i = 0; i < size && field[i]; ++i)
+			{
+				if (field[i] >= '0' && field[i] <= '7')
+				{
+					value = value * 8 + (field[i] - '0');
+				}
+			}
+			return value;
+		}
+
+		bool InputArchive::ReadTarHeaders(std::istream& archive, std::map<std::string, Member>& members)
+		{
+			char header[512];
+			unsigned long long offset = 0;
+			std::string longName;
+			while (archive.read(header, sizeof(header)))
+			{
+				offset += sizeof(header);
+				if (header[0] == 0)
+				{
+					break;
+				}
+				unsigned long long size = TarNumber(header + 124, 12);
+				char type = header[156];
+				std::string name(header, strnlen(header, 100));
+				if (memcmp(header + 257, "ustar", 5) == 0 && header[345])
+				{
+					name = std::string(header + 345, strnlen(header + 345, 155)) + "/" + name;
+				}
+
+				if (type == 'L' || type == 'x')
+				{
+					// the name of the next member: GNU long name, or the path record of a pax header
+					std::vector<char> data((size_t)size);
+					if (!archive.read(data.data(), data.size()))
+					{
+						return false;
+					}
+					if (type == 'L')
+					{
+						longName.assign(data.data(), strnlen(data.data(), data.size()));
+					}
+					else
+					{
+						std::string records(data.begin(), data.end());
+						size_t pos = records.find(" path=");
+						if (pos != std::string::npos)
+						{
+							size_t endOfLine = records.find('\n', pos);
+							longName = records.substr(pos + 6, endOfLine == std::string::npos ? std::string::npos : endOfLine - pos - 6);
+						}
+					}
+				}
+				else
+				{
+					if (!longName.empty())
+					{
+						name = longName;
+						longName.clear();
+					}
+					if (type == '0' || type == '\0' || type == '7')
+					{
+						Member member;
+						member.offset = offset;
+						member.packedSize = size;
+						member.size = size;
+						members[NormalizePath(name)] = member;
+					}
+				}
+				offset += (size + 511) & ~511ull;
+				archive.seekg((std::streamoff)offset);
+			}
+			return !members.empty();
+		}
+
+		const InputArchive::Member* InputArchive::Find(const std::string& path) const
+		{
+			std::string normalized = NormalizePath(path);
+			if (normalized.compare(0, _path.size(), _path) != 0 || normalized.size() <= _path.size() || normalized[_path.size()] != '/')
+			{
+				return nullptr;
+			}
+			auto found = _members.find(normalized.substr(_path.size() + 1));
+			return found == _members.end() ? nullptr : &found->second;
+		}
+
+		// the sub folders of Data/
+		void InputArchive::ListTiles(std::vector<std::string>& tiles) const
+		{
+			std::set<std::string> names;
+			for (const auto& member : _members)
+			{
+				const std::string& path = member.first;
+				size_t slash = path.find('/', 5);
+				if (path.compare(0, 5, "Data/") == 0 && slash != std::string::npos)
+				{
+					std::string tile = path.substr(5, slash - 5);
+					if (tile.find('.') == std::string::npos)
+					{
+						names.insert(tile);
+					}
+				}
+			}
+			tiles.assign(names.begin(), names.end());
+		}
+
+		bool InputArchive::ScanTile(const std::string& tileName, TileFiles& files) const
+		{
+			std::string prefix = "Data/" + tileName + "/";
+			files = TileFiles();
+			files.name = tileName;
+			files.baseNames.push_back(tileName);
+			auto top = _members.find(prefix + tileName + ".osgb");
+			files.bytes.push_back(top == _members.end() ? 0 : top->second.size);
+			for (auto it = _members.lower_bound(prefix); it != _members.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it)
+			{
+				std::string file = it->first.substr(prefix.size());
+				if (file.find('/') != std::string::npos || !IsOsgbFile(file))
+					continue;
+
+				std::string baseName = file.substr(0, file.size() - 5);
+				if (baseName == tileName)
+					continue;
+
+				files.baseNames.push_back(baseName);
+				files.bytes.push_back(it->second.size);
+			}
+			return true;
+		}
+
+		unsigned long long InputArchive::FileSize(const std::string& path) const
+		{
+			const Member* member = Find(path);
+			return member ? member->size : 0;
+		}
+
+		bool InputArchive::ReadFile(const std::string& path, std::vector<char>& data) const
+		{
+			const Member* member = Find(path);
+			if (!member)
+			{
+				seed::log::DumpLog(seed::log::Critical, "File %s is not in the archive!", path.c_str());
+				return false;
+			}
+			if (member->method != 0 && member->method != 8)
+			{
+				seed::log::DumpLog(seed::log::Critical, "File %s is encrypted or compressed with an unsupported method!", path.c_str());
+				return false;
+			}
+			// one stream per call: members are read concurrently
+			std::ifstream archive(_file, std::ios::in | std::ios::binary);
+			unsigned long long offset = member->offset;
+			if (_zip)
+			{
+				unsigned char local[30];
+				archive.seekg((std::streamoff)offset);
+				if (!archive.read((char*)local, sizeof(local)) || Get32(local) != 0x04034b50)
+				{
+					seed::log::DumpLog(seed::log::Critical, "Can NOT read file %s!", path.c_str());
+					return false;
+				}
+				offset += sizeof(local) + Get16(local + 26) + Get16(local + 28);
+			}
+			std::vector<char> packed((size_t)member->packedSize);
+			archive.seekg((std::streamoff)offset);
+			if (!archive.read(packed.data(), packed.size()))
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT read file %s!", path.c_str());
+				return false;
+			}
+			if (member->method == 0)
+			{
+				data.swap(packed);
+				return true;
+			}
+			data.clear();
+			data.reserve((size_t)member->size);
+			if (!Inflate((const unsigned char*)packed.data(), packed.size(), data) || data.size() != member->size)
+			{
+				seed::log::DumpLog(seed::log::Critical, "File %s is corrupt in the archive!", path.c_str());
+				return false;
+			}
+			return true;
+		}
+
+		osg::ref_ptr<osg::Node> InputArchive::ReadNode(const std::string& path) const
+		{
+			osgDB::ReaderWriter* reader = osgDB::Registry::instance()->getReaderWriterForExtension(osgDB::getLowerCaseFileExtension(path));
+			std::vector<char> data;
+			if (!reader || !ReadFile(path, data))
+			{
+				return nullptr;
+			}
+			MemoryBuffer buffer(data);
+			std::istream stream(&buffer);
+			osgDB::ReaderWriter::ReadResult result = reader->readNode(stream);
+			if (!result.success())
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT decode file %s: %s", path.c_str(), result.message().c_str());
+				return nullptr;
+			}
+			return result.takeNode();
+		}
+
+		osgDB::XmlNode* InputArchive::ReadXml(const std::string& path) const
+		{
+			std::vector<char> data;
+			if (!ReadFile(path, data))
+			{
+				return nullptr;
+			}
+			MemoryBuffer buffer(data);
+			std::istream stream(&buffer);
+			return osgDB::readXmlStream(stream);
+		}
+	}
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "tileScanner.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <osg/Node>
+#include <osg/ref_ptr>
+#include <osgDB/XmlParser>
+
+namespace seed
+{
+	namespace io
+	{
+		// An input tree read from a zip or tar archive instead of a folder: [<root>/]metadata.xml and
+		// [<root>/]Data/Tile_*/*.osgb. Paths are given as if the archive were the input folder
+		// ("<archive>/Data/<tile>/<file>.osgb"). Members are read and decompressed into memory by
+		// the calling thread, so files are decompressed in parallel by the converting threads.
+		class InputArchive
+		{
+		public:
+			// by extension: .zip or .tar
+			static bool IsArchive(const std::string& path);
+
+			bool Open(const std::string& path);
+
+			void ListTiles(std::vector<std::string>& tiles) const;
+			bool ScanTile(const std::string& tileName, TileFiles& files) const;
+			unsigned long long FileSize(const std::string& path) const;
+
+			bool ReadFile(const std::string& path, std::vector<char>& data) const;
+			osg::ref_ptr<osg::Node> ReadNode(const std::string& path) const;
+			osgDB::XmlNode* ReadXml(const std::string& path) const;
+
+		private:
+			struct Member
+			{
+				unsigned long long offset = 0;	// zip: of the local header, tar: of the data
+				unsigned long long packedSize = 0;
+				unsigned long long size = 0;
+				int method = 0;					// 0: stored, 8: deflated, -1: not supported
+			};
+
+			bool ReadZipDirectory(std::istream& archive, std::map<std::string, Member>& members);
+			bool ReadTarHeaders(std::istream& archive, std::map<std::string, Member>& members);
+			const Member* Find(const std::string& path) const;
+
+			std::string _file;
+			std::string _path;		// normalized, to match the paths of members
+			bool _zip = false;
+			std::map<std::string, Member> _members;	// by path relative to the root folder
+		};
+	}
+}
@@ -1,10 +1,35 @@
 #include "CmdParser/cmdparser.hpp"
 #include "common.h"
 #include "osgTo3mx.h"
+#include "outputBackend.h"
+#include "packFile.h"
+#include "storage.h"
+
+#include <algorithm>
 
 void configure_parser(cli::Parser& parser) {
-	parser.set_required<std::string>("i", "input", "input dir path");
-	parser.set_required<std::string>("o", "output", "output dir path");
+	parser.set_required<std::string>("i", "input", "input dir path, or a .zip or .tar archive of it");
+	parser.set_optional<std::string>("o", "output", "", "output dir path, or s3://<bucket>/<prefix> for 3mx (endpoint and keys from AWS_ENDPOINT_URL, AWS_ACCESS_KEY_ID, AWS_SECRET_ACCESS_KEY)");
+	parser.set_optional<std::string>("f", "format", "3mx", "output format: 3mx, 3dtiles or 3mx,3dtiles");
+	parser.set_optional<bool>("c", "coarse-lod", false, "build merged, decimated geometry for the levels above the tiles");
+	parser.set_optional<bool>("a", "atlas", false, "pack the small textures of a node into shared atlases");
+	parser.set_optional<bool>("m", "merge-geometries", false, "merge the geometries of a node that share a texture");
+	parser.set_optional<bool>("w", "weld", false, "weld duplicated vertices before encoding");
+	parser.set_optional<float>("wt", "weld-tolerance", 0.0f, "position tolerance of --weld, 0 welds bitwise equal vertices only");
+	parser.set_optional<bool>("q", "quantize", false, "quantize 3mx geometry positions within a pixel of the node switch distance");
+	parser.set_optional<bool>("pk", "pack", false, "append the 3mxb files to a few pack files with an index, in <output>/Pack, instead of writing them to <output>/Data");
+	parser.set_optional<bool>("up", "unpack", false, "write the files packed in <input>/Pack to <input>/Data, then exit");
+	parser.set_optional<std::string>("t", "timings", "", "file of per-file conversion times, read to schedule the slowest files first and rewritten");
+	parser.set_optional<int>("mm", "max-memory", 0, "memory in MB the files converted at once may take, 0: unlimited");
+	parser.set_optional<int>("th", "threads", 0, "files converted at once, 0: one per core");
+	parser.set_optional<bool>("vd", "verify-determinism", false, "convert again on another thread count to <output>.check and check that both outputs are byte-identical");
+	parser.set_optional<std::string>("qd", "queue", "", "queue folder on a shared file system for a distributed conversion, see --role");
+	parser.set_optional<std::string>("r", "role", "worker", "with --queue: init (queue the tiles), worker (convert queued tiles) or merge (write the root once all are done)");
+	parser.set_optional<std::string>("s", "shard", "", "i/N: convert only every N-th tile starting at the i-th (0 based), for external schedulers, see --merge-root");
+	parser.set_optional<std::string>("tl", "tiles", "", "convert only the tiles matching this comma separated list of names or globs (* and ?)");
+	parser.set_optional<std::string>("sc", "sidecars", "", "folder of the tile records written by --shard/--tiles and read by --merge-root, default <output>/Shards");
+	parser.set_optional<bool>("mr", "merge-root", false, "write the root levels from the tile records of all shards, once they are all done");
+	parser.set_optional<std::string>("p", "profiles", "", "output profiles, replace -o/-f/-q: \"format=3mx,output=<DIR>[,quality=80][,maxTextureSize=0][,geometryOnly=0][,quantize=0][,pack=0];...\"");
 }
 
 int main(int argc, char** argv)
@@ -13,9 +38,120 @@ int main(int argc, char** argv)
 	configure_parser(parser);
 	parser.run_and_exit_if_error();
 
+	std::string input = parser.get<std::string>("i");
+	if (parser.get<bool>("up"))
+	{
+		return seed::io::UnpackFiles(input + "/Pack/", input) ? 0 : 1;
+	}
+	std::string queue = parser.get<std::string>("qd");
+	std::string role = parser.get<std::string>("r");
+	if (!queue.empty() && role == "init")
+	{
+		return seed::io::OsgTo3mx().CreateQueue(input, queue) ? 0 : 1;
+	}
+
+	std::vector<seed::io::OutputProfile> profiles;
+	std::string profilesText = parser.get<std::string>("p");
+	if (!profilesText.empty())
+	{
+		if (!seed::io::ParseOutputProfiles(profilesText, profiles))
+		{
+			seed::log::DumpLog(seed::log::Critical, "Invalid profiles %s!", profilesText.c_str());
+			return 1;
+		}
+	}
+	else
+	{
+		std::string output = parser.get<std::string>("o");
+		std::string format = parser.get<std::string>("f");
+		if (output.empty())
+		{
+			seed::log::DumpLog(seed::log::Critical, "Either --output or --profiles is required!");
+			return 1;
+		}
+		bool with3mx = format.find("3mx") != std::string::npos;
+		bool with3dtiles = format.find("3dtiles") != std::string::npos;
+		if (with3mx)
+		{
+			seed::io::OutputProfile profile;
+			profile.format = "3mx";
+			profile.output = output;
+			profile.options.quantize = parser.get<bool>("q");
+			profile.options.pack = parser.get<bool>("pk");
+			profiles.push_back(profile);
+		}
+		if (with3dtiles)
+		{
+			// 3D Tiles go to a sub folder when written next to 3MX
+			seed::io::OutputProfile profile;
+			profile.format = "3dtiles";
+			profile.output = with3mx ? output + "/3DTiles" : output;
+			profiles.push_back(profile);
+		}
+		if (profiles.empty())
+		{
+			seed::log::DumpLog(seed::log::Critical, "Unknown output format %s!", format.c_str());
+			return 1;
+		}
+	}
+
 	seed::log::DumpLog(seed::log::Info, "Process started...");
 	seed::io::OsgTo3mx osgTo3mx;
-	if (osgTo3mx.Convert(parser.get<std::string>("i"), parser.get<std::string>("o")))
+	osgTo3mx.EnableCoarseLod(parser.get<bool>("c"));
+	osgTo3mx.EnableTextureAtlas(parser.get<bool>("a"));
+	osgTo3mx.EnableGeometryMerging(parser.get<bool>("m"));
+	osgTo3mx.SetTimingsFile(parser.get<std::string>("t"));
+	osgTo3mx.SetThreads((size_t)std::max(0, parser.get<int>("th")));
+	osgTo3mx.SetMaxMemory((unsigned long long)std::max(0, parser.get<int>("mm")) << 20);
+	osgTo3mx.EnableVertexWelding(parser.get<bool>("w"), parser.get<float>("wt"));
+	std::string shard = parser.get<std::string>("s");
+	std::string tiles = parser.get<std::string>("tl");
+	std::string sidecars = parser.get<std::string>("sc");
+	if (sidecars.empty())
+	{
+		sidecars = profiles.front().output + "/Shards";
+		if (seed::io::IsObjectStoreUrl(profiles.front().output) && (parser.get<bool>("mr") || !shard.empty() || !tiles.empty()))
+		{
+			// the records are local files
+			seed::log::DumpLog(seed::log::Critical, "--sidecars is required with an object store output!");
+			return 1;
+		}
+	}
+	sidecars += "/";
+	bool succeeded = false;
+	if (parser.get<bool>("mr"))
+	{
+		succeeded = osgTo3mx.MergeRoot(input, profiles, sidecars);
+	}
+	else if (!shard.empty() || !tiles.empty())
+	{
+		seed::io::TileSelection selection;
+		if (seed::io::ParseTileSelection(shard, tiles, selection))
+		{
+			succeeded = osgTo3mx.ConvertShard(input, profiles, selection, sidecars);
+		}
+	}
+	else if (queue.empty() && parser.get<bool>("vd"))
+	{
+		succeeded = osgTo3mx.VerifyDeterminism(input, profiles);
+	}
+	else if (queue.empty())
+	{
+		succeeded = osgTo3mx.Convert(input, profiles);
+	}
+	else if (role == "worker")
+	{
+		succeeded = osgTo3mx.ConvertQueue(input, profiles, queue);
+	}
+	else if (role == "merge")
+	{
+		succeeded = osgTo3mx.MergeQueue(input, profiles, queue);
+	}
+	else
+	{
+		seed::log::DumpLog(seed::log::Critical, "Unknown role %s!", role.c_str());
+	}
+	if (succeeded)
 	{
 		seed::log::DumpLog(seed::log::Info, "Process succeed!");
 	}
@@ -24,5 +160,5 @@ int main(int argc, char** argv)
 		seed::log::DumpLog(seed::log::Critical, "Process failed!");
 	}
 
-	return 1;	
+	return succeeded ? 0 : 1;
 }
\ No newline at end of file
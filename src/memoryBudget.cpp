@@ -0,0 +1,47 @@
+#include "memoryBudget.h"
+
+namespace seed
+{
+	namespace io
+	{
+		void MemoryBudget::SetLimit(unsigned long long limit)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_limit = limit;
+			_released.notify_all();
+		}
+
+		void MemoryBudget::Acquire(unsigned long long bytes)
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_released.wait(lock, [this, bytes]() { return _limit == 0 || _used == 0 || _used + bytes <= _limit; });
+			_used += bytes;
+		}
+
+		void MemoryBudget::Grow(unsigned long long bytes)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_used += bytes;
+		}
+
+		void MemoryBudget::Release(unsigned long long bytes)
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_used = bytes < _used ? _used - bytes : 0;
+			_released.notify_all();
+		}
+
+		void MemoryReservation::Resize(unsigned long long bytes)
+		{
+			if (bytes > _bytes)
+			{
+				_budget.Grow(bytes - _bytes);
+			}
+			else if (bytes < _bytes)
+			{
+				_budget.Release(_bytes - bytes);
+			}
+			_bytes = bytes;
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+
+namespace seed
+{
+	namespace io
+	{
+		// Bytes that concurrent tasks may hold at once. A task acquires its estimate before it loads
+		// anything and waits while that would exceed the limit, unless nothing else is held (so a
+		// task larger than the limit still runs, alone). Running tasks correct their estimate with
+		// Grow, which never waits: a task holding memory must not wait on the others.
+		class MemoryBudget
+		{
+		public:
+			MemoryBudget() {}
+
+			~MemoryBudget() {}
+
+			// 0: unlimited
+			void SetLimit(unsigned long long limit);
+			unsigned long long Limit() const { return _limit; }
+
+			void Acquire(unsigned long long bytes);
+			void Grow(unsigned long long bytes);
+			void Release(unsigned long long bytes);
+
+		private:
+			std::mutex _mutex;
+			std::condition_variable _released;
+			unsigned long long _limit = 0;
+			unsigned long long _used = 0;
+		};
+
+		// bytes held from a budget for the lifetime of a task
+		class MemoryReservation
+		{
+		public:
+			MemoryReservation(MemoryBudget& budget, unsigned long long bytes) : _budget(budget), _bytes(bytes) { _budget.Acquire(_bytes); }
+
+			~MemoryReservation() { _budget.Release(_bytes); }
+
+			// hold bytes from now on, once the estimate can be refined
+			void Resize(unsigned long long bytes);
+
+		private:
+			MemoryReservation(const MemoryReservation&) = delete;
+			MemoryReservation& operator=(const MemoryReservation&) = delete;
+
+			MemoryBudget& _budget;
+			unsigned long long _bytes;
+		};
+	}
+}
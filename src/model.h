@@ -0,0 +1,61 @@
+#pragma once
+
+#include <vector>
+#include <string>
+
+#include <osg/BoundingBox>
+#include <osg/Vec3d>
+
+namespace seed
+{
+	namespace io
+	{
+		// decoded geometry of a geometryBuffer resource
+		struct Mesh
+		{
+			std::vector<float> vertices;		// xyz
+			std::vector<float> normals;			// xyz, empty or one per vertex
+			std::vector<float> uvs;				// uv, empty or one per vertex
+			std::vector<unsigned char> colors;	// rgba, point-cloud only
+			std::vector<unsigned int> indices;	// triangles, tri-mesh only
+			osg::Vec3d origin;					// vertices are relative to it
+		};
+
+		// decoded pixels of a textureBuffer resource, rows stored top to bottom
+		struct Image
+		{
+			int width = 0;
+			int height = 0;
+			int comp = 0;
+			std::vector<unsigned char> pixels;
+		};
+
+		struct Node
+		{
+			std::string id;
+			osg::BoundingBox bb;
+			float maxScreenDiameter;
+			std::vector<std::string> children;
+			std::vector<std::string> resources;
+		};
+
+		struct Resource
+		{
+			std::string type;
+			std::string format;
+			std::string id;
+
+			std::string texture;
+			osg::BoundingBox bb;
+
+			Mesh mesh;
+			Image image;
+		};
+
+		struct Metadata
+		{
+			std::string srs;
+			osg::Vec3d srsOrigin = osg::Vec3d(0, 0, 0);
+		};
+	}
+}
@@ -1,30 +1,180 @@
 #include "osgTo3mx.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <execution>
+#include <fstream>
 #include <mutex>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <experimental/filesystem>
 
-#define STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "dxt_img.h"
-#include "stb_image_write.h"
-#include "openctm.h"
+#include "atlas.h"
+#include "weld.h"
+#include "arrayConvert.h"
+#include "tileQueue.h"
+#include "tileScanner.h"
+#include "storage.h"
 
 namespace seed
 {
 	namespace io
 	{
-		void write_buf(void* context, void* data, int len) {
-			std::vector<char>* buf = (std::vector<char>*)context;
-			buf->insert(buf->end(), (char*)data, (char*)data + len);
-		}
-
-		static CTMuint CTMCALL _ctm_write_buf(const void * aBuf, CTMuint aCount, void * aUserData)
+#if _HAS_CXX17 && !_DEBUG
+		static const bool ParallelForEnabled = true;
+#else
+		static const bool ParallelForEnabled = false;
+#endif
+
+		// Run func(0) .. func(count - 1) on the parallel algorithms pool; calls made from a task
+		// already running on it share the same workers. In order on this thread when not parallel.
+		template<typename Func>
+		static void ParallelFor(size_t count, Func func, bool parallel = true)
 		{
-			std::vector<char>* buf = (std::vector<char>*)aUserData;
-			buf->insert(buf->end(), (char*)aBuf, (char*)aBuf + aCount);
-			return aCount;
-		}
-
+			std::vector<size_t> indices(count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				indices[i] = i;
+			}
+#if _HAS_CXX17 && !_DEBUG
+			if (parallel)
+			{
+				std::for_each(std::execution::par, std::begin(indices), std::end(indices), func);
+				return;
+			}
+			std::for_each(std::begin(indices), std::end(indices), func);
+#else
+			(void)parallel;
+			std::for_each(std::begin(indices), std::end(indices), func);
+#endif
+		}
+
+		// Whether this geode is the only user of a texture, so its image can be dropped once
+		// decoded: the texture belongs to one state set, of one geometry, of one geode.
+		static bool IsTextureOwned(osg::Texture* texture, const std::map<osg::Geometry*, osg::Texture*>& textureMap)
+		{
+			if (texture->referenceCount() != 1)
+				return false;
+			for (const auto& entry : textureMap)
+			{
+				if (entry.second == texture && (entry.first->referenceCount() != 1 || entry.first->getStateSet()->referenceCount() != 1))
+					return false;
+			}
+			return true;
+		}
+
+		// drop the arrays of a geometry once converted, unless another geode shares it
+		static void ReleaseGeometryData(osg::Geometry* geometry)
+		{
+			if (geometry->referenceCount() != 1)
+				return;
+
+			geometry->setVertexArray(nullptr);
+			geometry->setNormalArray(nullptr);
+			geometry->setColorArray(nullptr);
+			for (unsigned int unit = 0; unit < geometry->getNumTexCoordArrays(); ++unit)
+			{
+				geometry->setTexCoordArray(unit, nullptr);
+			}
+			geometry->removePrimitiveSet(0, geometry->getNumPrimitiveSets());
+		}
+
+		static bool IsTriangleMode(GLenum mode)
+		{
+			return mode == GL_TRIANGLES || mode == GL_TRIANGLE_STRIP || mode == GL_TRIANGLE_FAN
+				|| mode == GL_QUADS || mode == GL_QUAD_STRIP || mode == GL_POLYGON;
+		}
+
+		// number of triangles produced by count vertices drawn in mode
+		static size_t CountTriangles(GLenum mode, size_t count)
+		{
+			switch (mode)
+			{
+			case GL_TRIANGLES: return count / 3;
+			case GL_TRIANGLE_STRIP:
+			case GL_TRIANGLE_FAN:
+			case GL_POLYGON: return count >= 3 ? count - 2 : 0;
+			case GL_QUADS: return count / 4 * 2;
+			case GL_QUAD_STRIP: return count >= 4 ? (count - 2) / 2 * 2 : 0;
+			default: return 0;
+			}
+		}
+
+		static size_t CountTriangles(osg::PrimitiveSet* ps)
+		{
+			if (ps->getType() == osg::PrimitiveSet::DrawArrayLengthsPrimitiveType)
+			{
+				size_t triangles = 0;
+				for (auto length : *static_cast<osg::DrawArrayLengths*>(ps))
+				{
+					triangles += CountTriangles(ps->getMode(), length);
+				}
+				return triangles;
+			}
+			return CountTriangles(ps->getMode(), ps->getNumIndices());
+		}
+
+		// Triangulate count vertices drawn in mode, index(i) giving the vertex of the i-th one.
+		// Triangle and quad lists are kept as they are. Strips and fans keep a consistent winding
+		// and skip the degenerate triangles used to stitch or restart them.
+		template<typename IndexFunc>
+		static void AppendTriangles(GLenum mode, size_t count, IndexFunc index, std::vector<unsigned int>& indices)
+		{
+			auto append = [&indices](unsigned int a, unsigned int b, unsigned int c)
+			{
+				indices.push_back(a);
+				indices.push_back(b);
+				indices.push_back(c);
+			};
+			auto push = [&append](unsigned int a, unsigned int b, unsigned int c)
+			{
+				if (a == b || b == c || a == c)
+					return;
+				append(a, b, c);
+			};
+			switch (mode)
+			{
+			case GL_TRIANGLES:
+				for (size_t i = 0; i + 2 < count; i += 3)
+					append(index(i), index(i + 1), index(i + 2));
+				break;
+			case GL_TRIANGLE_STRIP:
+				for (size_t i = 2; i < count; ++i)
+				{
+					if (i & 1)
+						push(index(i - 1), index(i - 2), index(i));
+					else
+						push(index(i - 2), index(i - 1), index(i));
+				}
+				break;
+			case GL_TRIANGLE_FAN:
+			case GL_POLYGON:
+				for (size_t i = 2; i < count; ++i)
+					push(index(0), index(i - 1), index(i));
+				break;
+			case GL_QUADS:
+				for (size_t i = 0; i + 3 < count; i += 4)
+				{
+					append(index(i), index(i + 1), index(i + 2));
+					append(index(i), index(i + 2), index(i + 3));
+				}
+				break;
+			case GL_QUAD_STRIP:
+				for (size_t i = 0; i + 3 < count; i += 2)
+				{
+					push(index(i), index(i + 1), index(i + 3));
+					push(index(i), index(i + 3), index(i + 2));
+				}
+				break;
+			default:
+				break;
+			}
+		}
+
 		class InfoVisitor : public osg::NodeVisitor
 		{
 			std::string path;
@@ -38,7 +188,9 @@ namespace seed
 				if (auto ss = geometry.getStateSet()) {
 					osg::Texture* tex = dynamic_cast<osg::Texture*>(ss->getTextureAttribute(0, osg::StateAttribute::TEXTURE));
 					if (tex) {
-						texture_array.insert(tex);
+						if (texture_set.insert(tex).second) {
+							texture_array.push_back(tex);
+						}
 						texture_map[&geometry] = tex;
 					}
 				}
@@ -46,130 +198,683 @@ namespace seed
 
 		public:
 			std::vector<osg::Geometry*> geometry_array;
-			std::set<osg::Texture*> texture_array;
+			// in order of first use: the texture ids must not depend on where the textures were allocated
+			std::vector<osg::Texture*> texture_array;
+			std::set<osg::Texture*> texture_set;
 			std::map<osg::Geometry*, osg::Texture*> texture_map;
 		};
 
-		bool OsgTo3mx::Convert(const std::string& input, const std::string& output)
+		bool OsgTo3mx::Convert(const std::string& input, const std::vector<OutputProfile>& profiles)
 		{
-			std::string inputMetadata = input + "/metadata.xml";
+			if (!OpenInput(input))
+			{
+				return false;
+			}
 			std::string inputData = input + "/Data/";
-			
-			std::string outputMetadata = output + "/metadata.xml";
-			std::string output3mx = output + "/Root.3mx";
-			std::string outputData = output + "/Data/";
-			std::string outputDataRootRelative = "Data/Root.3mxb";
-			std::string outputDataRoot = output + "/" + outputDataRootRelative;
+			if (!CreateBackends(profiles))
+			{
+				return false;
+			}
 
 			seed::progress::UpdateProgress(0);
-			if (!utils::CheckOrCreateFolder(output))
-			{
-				seed::log::DumpLog(seed::log::Critical, "Create folder %s failed!", output.c_str());
-				return false;
-			}
-			if (!utils::CheckOrCreateFolder(outputData))
-			{
-				seed::log::DumpLog(seed::log::Critical, "Create folder %s failed!", outputData.c_str());
-				return false;
-			}
-
-			if (!GenerateMetadata(outputMetadata))
-			{
-				seed::log::DumpLog(seed::log::Critical, "Generate %s failed!", outputMetadata.c_str());
-				return false;
-			}
-
-			if (!ConvertMetadataTo3mx(inputMetadata, outputDataRootRelative, output3mx))
-			{
-				seed::log::DumpLog(seed::log::Critical, "Generate %s failed!", output3mx.c_str());
-				return false;
-			}
-
-			osgDB::DirectoryContents fileNames = osgDB::getDirectoryContents(inputData);
+			ReadTimings();
+			if (!BeginBackends(input))
+			{
+				return false;
+			}
 
-			std::vector<Node> nodes;
-			std::vector<Resource> resourcesGeometry;
-			std::vector<Resource> resourcesTexture;
+			std::vector<std::string> tiles;
+			ListTiles(inputData, tiles);
 
-			int processed = 0;
-			int percent = -1;
+			std::vector<Node> nodes;
 
-			for each (std::string dir in fileNames)
-			{
-				if (dir.find(".") != std::string::npos)
-					continue;
+			int processed = 0;
+			int percent = -1;
 
-				std::string output3mxbName = dir + "/" + dir + ".3mxb";
-				std::string output3mxb = outputData + output3mxbName;
+			TileScanner scanner(inputData, tiles, _archive.get());
+			for (size_t t = 0; t < tiles.size(); ++t)
+			{
+				const std::string& tile = tiles[t];
+				TileFiles files;
 				osg::BoundingBox bb;
-				if (!ConvertTile(inputData, outputData, dir, bb))
-				{
-					seed::log::DumpLog(seed::log::Critical, "Generate %s failed!", output3mxb.c_str());
-					return false;
+				if (!scanner.Wait(t, files) || !ConvertTile(inputData, files, bb))
+				{
+					seed::log::DumpLog(seed::log::Critical, "Convert tile %s failed!", tile.c_str());
+					return false;
 				}
 				if (bb.valid())
 				{
-					Node node;
-					node.id = dir;
-					node.bb = bb;
-					node.maxScreenDiameter = 0;
-					node.children.push_back(output3mxbName);
-					nodes.push_back(node);
+					nodes.push_back(TileNode(tile, bb));
 				}
-
-				{
-					processed++;
-					int cur = processed * 100 / fileNames.size();
+
+				{
+					processed++;
+					int cur = processed * 100 / (int)tiles.size();
 					if (cur > percent)
 					{
 						seed::progress::UpdateProgress(cur);
 						percent = cur;
 					}
 				}
-			}
+			}
+
+			if (!FinishRoot(inputData, nodes))
+			{
+				return false;
+			}
+			WriteTimings();
+			seed::progress::UpdateProgress(100);
+			return true;
+		}
+
+		// Files of the expected folder missing or different in the actual one, and the other way
+		// round, are logged. The folders are walked in sorted order for a stable report.
+		static bool CompareFolders(const std::string& expected, const std::string& actual)
+		{
+			namespace fs = std::experimental::filesystem;
+			std::set<std::string> paths;
+			for (const std::string& root : { expected, actual })
+			{
+				std::error_code ec;
+				for (fs::recursive_directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec))
+				{
+					if (fs::is_regular_file(it->path()))
+					{
+						paths.insert(it->path().string().substr(root.size()));
+					}
+				}
+			}
+			size_t differences = 0;
+			for (const auto& path : paths)
+			{
+				std::ifstream expectedFile(expected + path, std::ios::binary);
+				std::ifstream actualFile(actual + path, std::ios::binary);
+				if (!expectedFile || !actualFile)
+				{
+					seed::log::DumpLog(seed::log::Critical, "%s is written by one run only!", path.c_str());
+					differences++;
+					continue;
+				}
+				std::vector<char> expectedBytes((std::istreambuf_iterator<char>(expectedFile)), std::istreambuf_iterator<char>());
+				std::vector<char> actualBytes((std::istreambuf_iterator<char>(actualFile)), std::istreambuf_iterator<char>());
+				if (expectedBytes != actualBytes)
+				{
+					seed::log::DumpLog(seed::log::Critical, "%s differs between the runs!", path.c_str());
+					differences++;
+				}
+			}
+			seed::log::DumpLog(seed::log::Info, "Compared %d files of %s, %d differ.", (int)paths.size(), expected.c_str(), (int)differences);
+			return differences == 0;
+		}
+
+		bool OsgTo3mx::VerifyDeterminism(const std::string& input, const std::vector<OutputProfile>& profiles)
+		{
+			// both runs would convert everything in order and match whatever the scheduling does
+			if (!ParallelForEnabled)
+			{
+				seed::log::DumpLog(seed::log::Critical, "This build converts in order on one thread, the output can not be verified!");
+				return false;
+			}
+
+			// an output in the folder of another one (3DTiles next to 3MX) is checked with it
+			std::vector<OutputProfile> checkProfiles = profiles;
+			std::vector<char> nested(profiles.size(), 0);
+			for (size_t i = 0; i < profiles.size(); ++i)
+			{
+				if (profiles[i].options.pack || IsObjectStoreUrl(profiles[i].output))
+				{
+					// the order of the files in a pack depends on the scheduling, their content does not
+					seed::log::DumpLog(seed::log::Critical, "Only folder outputs can be verified, not %s!", profiles[i].output.c_str());
+					return false;
+				}
+				checkProfiles[i].output = profiles[i].output + ".check";
+				for (size_t j = 0; j < profiles.size(); ++j)
+				{
+					const std::string& parent = profiles[j].output;
+					if (j != i && profiles[i].output.compare(0, parent.size() + 1, parent + "/") == 0)
+					{
+						checkProfiles[i].output = parent + ".check" + profiles[i].output.substr(parent.size());
+						nested[i] = 1;
+					}
+				}
+				if (!nested[i])
+				{
+					std::error_code ec;
+					std::experimental::filesystem::remove_all(checkProfiles[i].output, ec);
+				}
+			}
+
+			// two different multi-thread counts, so each run schedules the files differently
+			size_t threads = _threads;
+			size_t first = std::max<size_t>(2, _threads ? _threads : std::thread::hardware_concurrency());
+			size_t second = first >= 4 ? first / 2 : first + 1;
+			_threads = first;
+			if (!Convert(input, profiles))
+			{
+				_threads = threads;
+				return false;
+			}
+			_threads = second;
+			seed::log::DumpLog(seed::log::Info, "Converting again on %d threads to verify the output...", (int)second);
+			bool converted = Convert(input, checkProfiles);
+			_threads = threads;
+			if (!converted)
+			{
+				return false;
+			}
+
+			bool identical = true;
+			for (size_t i = 0; i < profiles.size(); ++i)
+			{
+				if (nested[i])
+				{
+					continue;
+				}
+				if (CompareFolders(profiles[i].output + "/", checkProfiles[i].output + "/"))
+				{
+					std::error_code ec;
+					std::experimental::filesystem::remove_all(checkProfiles[i].output, ec);
+				}
+				else
+				{
+					identical = false;
+				}
+			}
+			return identical;
+		}
+
+		bool OsgTo3mx::CreateQueue(const std::string& input, const std::string& queueDir)
+		{
+			if (!OpenInput(input))
+			{
+				return false;
+			}
+			std::vector<std::string> tiles;
+			ListTiles(input + "/Data/", tiles);
+			if (tiles.empty())
+			{
+				seed::log::DumpLog(seed::log::Critical, "No tile found in %s/Data/!", input.c_str());
+				return false;
+			}
+			TileQueue queue(queueDir);
+			if (!queue.Create(tiles))
+			{
+				return false;
+			}
+			seed::log::DumpLog(seed::log::Info, "Queued %d tiles in %s", (int)tiles.size(), queueDir.c_str());
+			return true;
+		}
+
+		bool OsgTo3mx::ConvertQueue(const std::string& input, const std::vector<OutputProfile>& profiles, const std::string& queueDir)
+		{
+			if (!OpenInput(input))
+			{
+				return false;
+			}
+			std::string inputData = input + "/Data/";
+			if (!CreateBackends(profiles))
+			{
+				return false;
+			}
+			ReadTimings();
+
+			// unique among the processes sharing the queue, on any machine
+			std::random_device random;
+			char worker[32];
+			snprintf(worker, sizeof(worker), "%08x%08x", random(), (unsigned int)std::chrono::system_clock::now().time_since_epoch().count());
+
+			TileQueue queue(queueDir);
+			std::string tile;
+			int converted = 0;
+			bool succeeded = true;
+			while (queue.Claim(worker, tile))
+			{
+				seed::log::DumpLog(seed::log::Info, "Worker %s converts tile %s ...", worker, tile.c_str());
+				TileFiles files;
+				TileRecord record;
+				bool listed = _archive ? _archive->ScanTile(tile, files) : ScanTile(inputData, tile, files);
+				if (!listed || !ConvertRecordedTile(inputData, files, queue.DoneDir(), record) || !queue.Complete(worker, record))
+				{
+					queue.Fail(worker, tile);
+					succeeded = false;
+					continue;
+				}
+				converted++;
+			}
+			seed::log::DumpLog(seed::log::Info, "Worker %s converted %d tiles.", worker, converted);
+			WriteTimings();
+			return succeeded;
+		}
+
+		bool OsgTo3mx::MergeQueue(const std::string& input, const std::vector<OutputProfile>& profiles, const std::string& queueDir)
+		{
+			if (!OpenInput(input))
+			{
+				return false;
+			}
+			TileQueue queue(queueDir);
+			size_t todo = 0, claimed = 0, failed = 0;
+			queue.Count(todo, claimed, failed);
+			if (todo || claimed || failed)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Queue %s is not finished: %d to do, %d being converted, %d failed!", queueDir.c_str(), (int)todo, (int)claimed, (int)failed);
+				return false;
+			}
+			std::vector<TileRecord> records;
+			if (!ReadTileRecords(queue.DoneDir(), records))
+			{
+				return false;
+			}
+			return MergeRecords(input, profiles, records);
+		}
+
+		// Convert the tiles selected by shard and pattern, and write their records (bounding box
+		// sidecars) to recordsDir for a later MergeRoot.
+		bool OsgTo3mx::ConvertShard(const std::string& input, const std::vector<OutputProfile>& profiles, const TileSelection& selection, const std::string& recordsDir)
+		{
+			if (!OpenInput(input))
+			{
+				return false;
+			}
+			std::string inputData = input + "/Data/";
+			if (!CreateBackends(profiles) || !seed::utils::CheckOrCreateFolder(recordsDir))
+			{
+				return false;
+			}
+			ReadTimings();
+
+			std::vector<std::string> tiles;
+			ListTiles(inputData, tiles);
+			SelectTiles(selection, tiles);
+			seed::log::DumpLog(seed::log::Info, "Shard %d/%d: %d tiles", selection.shardIndex, selection.shardCount, (int)tiles.size());
+
+			int processed = 0;
+			TileScanner scanner(inputData, tiles, _archive.get());
+			for (size_t t = 0; t < tiles.size(); ++t)
+			{
+				TileFiles files;
+				TileRecord record;
+				if (!scanner.Wait(t, files) || !ConvertRecordedTile(inputData, files, recordsDir, record) || !WriteTileRecord(recordsDir, record))
+				{
+					return false;
+				}
+				processed++;
+				seed::progress::UpdateProgress(processed * 100 / (int)tiles.size());
+			}
+			WriteTimings();
+			return true;
+		}
+
+		// write the root levels from the records of all tiles, without reading them again
+		bool OsgTo3mx::MergeRoot(const std::string& input, const std::vector<OutputProfile>& profiles, const std::string& recordsDir)
+		{
+			if (!OpenInput(input))
+			{
+				return false;
+			}
+			std::vector<TileRecord> records;
+			if (!ReadTileRecords(recordsDir, records))
+			{
+				return false;
+			}
+			std::set<std::string> recorded;
+			for (const auto& record : records)
+			{
+				recorded.insert(record.name);
+			}
+			std::vector<std::string> tiles;
+			ListTiles(input + "/Data/", tiles);
+			size_t missing = 0;
+			for (const auto& tile : tiles)
+			{
+				if (!recorded.count(tile))
+				{
+					seed::log::DumpLog(seed::log::Critical, "Tile %s has no record in %s!", tile.c_str(), recordsDir.c_str());
+					missing++;
+				}
+			}
+			if (missing)
+			{
+				return false;
+			}
+			return MergeRecords(input, profiles, records);
+		}
+
+		// "i/N" and a comma separated list of tile names or globs (* and ?)
+		bool ParseTileSelection(const std::string& shard, const std::string& pattern, TileSelection& selection)
+		{
+			selection = TileSelection();
+			if (!shard.empty())
+			{
+				int index = 0, count = 0;
+				char slash = 0;
+				std::stringstream shardStream(shard);
+				if (!(shardStream >> index >> slash >> count) || slash != '/' || count < 1 || index < 0 || index >= count)
+				{
+					seed::log::DumpLog(seed::log::Critical, "Invalid shard %s, expected i/N with 0 <= i < N!", shard.c_str());
+					return false;
+				}
+				selection.shardIndex = index;
+				selection.shardCount = count;
+			}
+			std::stringstream patternStream(pattern);
+			std::string item;
+			while (std::getline(patternStream, item, ','))
+			{
+				if (!item.empty())
+				{
+					selection.patterns.push_back(item);
+				}
+			}
+			return true;
+		}
+
+		static bool MatchGlob(const char* pattern, const char* text)
+		{
+			if (*pattern == '\0')
+				return *text == '\0';
+			if (*pattern == '*')
+				return MatchGlob(pattern + 1, text) || (*text && MatchGlob(pattern, text + 1));
+			if (*text && (*pattern == '?' || *pattern == *text))
+				return MatchGlob(pattern + 1, text + 1);
+			return false;
+		}
+
+		// the pattern filter first, then every N-th of the sorted remaining tiles, so that shards
+		// are disjoint and stable across runs
+		void OsgTo3mx::SelectTiles(const TileSelection& selection, std::vector<std::string>& tiles)
+		{
+			std::vector<std::string> selected;
+			for (const auto& tile : tiles)
+			{
+				bool matched = selection.patterns.empty();
+				for (size_t k = 0; k < selection.patterns.size() && !matched; ++k)
+				{
+					matched = MatchGlob(selection.patterns[k].c_str(), tile.c_str());
+				}
+				if (matched)
+				{
+					selected.push_back(tile);
+				}
+			}
+			tiles.clear();
+			for (size_t i = 0; i < selected.size(); ++i)
+			{
+				if ((int)(i % selection.shardCount) == selection.shardIndex)
+				{
+					tiles.push_back(selected[i]);
+				}
+			}
+		}
+
+		// convert one tile for a later merge: its record, and its proxy saved next to it
+		bool OsgTo3mx::ConvertRecordedTile(const std::string& inputData, const TileFiles& files, const std::string& recordsDir, TileRecord& record)
+		{
+			const std::string& tileName = files.name;
+			record = TileRecord();
+			record.name = tileName;
+			if (!ConvertTile(inputData, files, record.bb))
+			{
+				seed::log::DumpLog(seed::log::Critical, "Convert tile %s failed!", tileName.c_str());
+				return false;
+			}
+			auto proxy = _proxies.find(tileName);
+			if (proxy != _proxies.end())
+			{
+				record.proxyPath = recordsDir + tileName + ".proxy";
+				bool saved = SaveProxy(proxy->second, record.proxyPath);
+				_proxies.erase(proxy);
+				return saved;
+			}
+			return true;
+		}
+
+		// build the root levels from the records of tiles converted by other processes
+		bool OsgTo3mx::MergeRecords(const std::string& input, const std::vector<OutputProfile>& profiles, const std::vector<TileRecord>& records)
+		{
+			if (!CreateBackends(profiles) || !BeginBackends(input))
+			{
+				return false;
+			}
+			std::vector<Node> nodes;
+			for (const auto& record : records)
+			{
+				if (!record.bb.valid())
+					continue;
+
+				nodes.push_back(TileNode(record.name, record.bb));
+				if (_coarseLod && !record.proxyPath.empty())
+				{
+					Proxy proxy;
+					if (!LoadProxy(record.proxyPath, proxy))
+					{
+						return false;
+					}
+					_proxies[record.name] = std::move(proxy);
+				}
+			}
+			return FinishRoot(input + "/Data/", nodes);
+		}
+
+		bool OsgTo3mx::CreateBackends(const std::vector<OutputProfile>& profiles)
+		{
+			_backends.clear();
+			_proxies.clear();
+			for (OutputProfile profile : profiles)
+			{
+				profile.options.parallelPacking = _threads == 1;
+				auto backend = CreateOutputBackend(profile);
+				if (!backend)
+				{
+					return false;
+				}
+				_backends.push_back(backend);
+			}
+			return true;
+		}
 
-			if (nodes.empty())
+		bool OsgTo3mx::BeginBackends(const std::string& input)
+		{
+			Metadata metadata;
+			ReadMetadata(input + "/metadata.xml", metadata);
+			for (auto& backend : _backends)
 			{
-				seed::log::DumpLog(seed::log::Warning, "Extract 0 node from %s", inputData.c_str());
-				return false;
+				if (!backend->Begin(metadata))
+				{
+					seed::log::DumpLog(seed::log::Critical, "Initialize %s output failed!", backend->Name());
+					return false;
+				}
 			}
+			return true;
+		}
 
-			if (!Generate3mxb(nodes, resourcesGeometry, resourcesTexture, outputDataRoot))
-			{
-				seed::log::DumpLog(seed::log::Critical, "Generate %s failed!", outputDataRoot.c_str());
-				return false;
-			}
-			seed::progress::UpdateProgress(100);
-			return true;
-		}
+		// every sub folder of Data/ is a tile
+		bool OsgTo3mx::OpenInput(const std::string& input)
+		{
+			_archive.reset();
+			if (InputArchive::IsArchive(input))
+			{
+				_archive = std::make_shared<InputArchive>();
+				if (!_archive->Open(input))
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		void OsgTo3mx::ListTiles(const std::string& inputData, std::vector<std::string>& tiles)
+		{
+			if (_archive)
+			{
+				_archive->ListTiles(tiles);
+				return;
+			}
+			osgDB::DirectoryContents fileNames = osgDB::getDirectoryContents(inputData);
+			for each (std::string dir in fileNames)
+			{
+				if (dir.find(".") != std::string::npos)
+					continue;
+
+				tiles.push_back(dir);
+			}
+			std::sort(tiles.begin(), tiles.end());
+		}
 
-		bool OsgTo3mx::GenerateMetadata(const std::string& output)
-		{
-			std::ofstream outfile(output);
-			if (outfile.bad())
+		Node OsgTo3mx::TileNode(const std::string& tileName, const osg::BoundingBox& bb)
+		{
+			Node node;
+			node.id = tileName;
+			node.bb = bb;
+			node.maxScreenDiameter = 0;
+			node.children.push_back(tileName + "/" + tileName);
+			return node;
+		}
+
+		bool OsgTo3mx::FinishRoot(const std::string& inputData, std::vector<Node>& nodes)
+		{
+			if (nodes.empty())
 			{
-				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", output.c_str());
+				seed::log::DumpLog(seed::log::Warning, "Extract 0 node from %s", inputData.c_str());
 				return false;
 			}
-			outfile << "<?xml version=\"1.0\" encoding=\"utf - 8\"?>\n";
-			outfile << "<ModelMetadata version=\"1\">\n";
-			outfile << "	<Texture>\n";
-			outfile << "		<ColorSource>Visible</ColorSource>\n";
-			outfile << "	</Texture>\n";
-			outfile << "</ModelMetadata>\n";
-			if (outfile.bad())
+
+			std::vector<Resource> resourcesGeometry;
+			std::vector<Resource> resourcesTexture;
+			if (!BuildRootHierarchy(nodes, "", resourcesGeometry, resourcesTexture))
+			{
+				return false;
+			}
+			_proxies.clear();
+
+			for (auto& backend : _backends)
 			{
-				seed::log::DumpLog(seed::log::Critical, "An error has occurred while writing file %s!", output.c_str());
-				return false;
+				if (!backend->End(nodes, resourcesGeometry, resourcesTexture))
+				{
+					seed::log::DumpLog(seed::log::Critical, "Finalize %s output failed!", backend->Name());
+					return false;
+				}
 			}
+			return true;
+		}
+
+		// Group the tile nodes into a quadtree of Data/Root_<key> files, splitting at the median
+		// x and then the median y of the node centers, so that each level has at most
+		// MaxRootChildren nodes and the viewer culls the tiles level by level.
+		// With coarse LOD the new nodes carry a proxy of their children, stored in
+		// resourcesGeometry/resourcesTexture of the level that holds them.
+		bool OsgTo3mx::BuildRootHierarchy(std::vector<Node>& nodes, const std::string& key, std::vector<Resource>& resourcesGeometry, std::vector<Resource>& resourcesTexture)
+		{
+			if (nodes.size() <= MaxRootChildren)
+			{
+				return true;
+			}
+
+			auto byX = [](const Node& a, const Node& b) { return a.bb.center().x() < b.bb.center().x(); };
+			auto byY = [](const Node& a, const Node& b) { return a.bb.center().y() < b.bb.center().y(); };
+			size_t half = nodes.size() / 2;
+			std::nth_element(nodes.begin(), nodes.begin() + half, nodes.end(), byX);
+			std::nth_element(nodes.begin(), nodes.begin() + half / 2, nodes.begin() + half, byY);
+			std::nth_element(nodes.begin() + half, nodes.begin() + half + (nodes.size() - half) / 2, nodes.end(), byY);
+			size_t bounds[5] = { 0, half / 2, half, half + (nodes.size() - half) / 2, nodes.size() };
+
+			std::vector<Node> quadrants;
+			for (int q = 0; q < 4; ++q)
+			{
+				std::vector<Node> children(nodes.begin() + bounds[q], nodes.begin() + bounds[q + 1]);
+				if (children.size() == 1)
+				{
+					quadrants.push_back(children[0]);
+					continue;
+				}
+
+				std::string childKey = key + std::to_string(q);
+				std::vector<Resource> childGeometry;
+				std::vector<Resource> childTexture;
+				if (!BuildRootHierarchy(children, childKey, childGeometry, childTexture))
+				{
+					return false;
+				}
+
+				std::string baseName = "Root_" + childKey;
+				for (auto& backend : _backends)
+				{
+					if (!backend->WriteFile("", baseName, children, childGeometry, childTexture))
+					{
+						seed::log::DumpLog(seed::log::Critical, "Generate %s output of %s failed!", backend->Name(), baseName.c_str());
+						return false;
+					}
+				}
+
+				Node node;
+				node.id = baseName;
+				for (const auto& child : children)
+				{
+					node.bb.expandBy(child.bb);
+				}
+				node.maxScreenDiameter = 0;
+				node.children.push_back(baseName);
+				if (_coarseLod)
+				{
+					BuildNodeProxy(node, children, resourcesGeometry, resourcesTexture);
+				}
+				quadrants.push_back(node);
+			}
+			nodes.swap(quadrants);
+			return true;
+		}
+
+		// merge the proxies of the children into one for node, shown until it is larger than its atlas
+		bool OsgTo3mx::BuildNodeProxy(Node& node, const std::vector<Node>& children, std::vector<Resource>& resourcesGeometry, std::vector<Resource>& resourcesTexture)
+		{
+			std::vector<const Mesh*> meshes;
+			std::vector<const Image*> textures;
+			for (const auto& child : children)
+			{
+				auto found = _proxies.find(child.id);
+				if (found != _proxies.end())
+				{
+					meshes.push_back(&found->second.mesh);
+					textures.push_back(&found->second.image);
+				}
+			}
+
+			Proxy proxy;
+			bool built = !meshes.empty() && BuildProxy(meshes, textures, ProxyTextureSize, ProxyTriangles, proxy);
+			for (const auto& child : children)
+			{
+				_proxies.erase(child.id);
+			}
+			if (!built)
+			{
+				return false;
+			}
+
+			Resource resTexture;
+			resTexture.type = "textureBuffer";
+			resTexture.format = "jpg";
+			resTexture.id = "texture" + std::to_string(resourcesTexture.size());
+			resTexture.image = proxy.image;
+
+			Resource resGeometry;
+			resGeometry.type = "geometryBuffer";
+			resGeometry.format = "ctm";
+			resGeometry.id = "geometry" + std::to_string(resourcesGeometry.size());
+			resGeometry.texture = resTexture.id;
+			resGeometry.bb = proxy.bb;
+			resGeometry.mesh = proxy.mesh;
+
+			node.resources.push_back(resGeometry.id);
+			node.maxScreenDiameter = (float)std::max(proxy.image.width, proxy.image.height);
+			resourcesTexture.emplace_back(std::move(resTexture));
+			resourcesGeometry.emplace_back(std::move(resGeometry));
+			_proxies[node.id] = std::move(proxy);
 			return true;
 		}
 
-		bool OsgTo3mx::ConvertMetadataTo3mx(const std::string& input, const std::string& outputDataRootRelative, const std::string& output)
+		void OsgTo3mx::ReadMetadata(const std::string& input, Metadata& metadata)
 		{
-			std::string srs;
-			osg::Vec3d srsOrigin(0, 0, 0);
-			auto xml = osgDB::readXmlFile(input);
+			osg::ref_ptr<osgDB::XmlNode> xml = _archive ? _archive->ReadXml(input) : osgDB::readXmlFile(input);
 			if (xml)
 			{
 				for (auto i : xml->children)
@@ -180,11 +885,11 @@ namespace seed
 						{
 							if (j->name == "SRS")
 							{
-								srs = j->contents;
+								metadata.srs = j->contents;
 							}
 							if (j->name == "SRSOrigin")
 							{
-								sscanf(j->contents.c_str(), "%lf,%lf,%lf", &srsOrigin._v[0], &srsOrigin._v[1], &srsOrigin._v[2]);
+								sscanf(j->contents.c_str(), "%lf,%lf,%lf", &metadata.srsOrigin._v[0], &metadata.srsOrigin._v[1], &metadata.srsOrigin._v[2]);
 							}
 						}
 						break;
@@ -195,115 +900,192 @@ namespace seed
 			{
 				seed::log::DumpLog(seed::log::Warning, "Can NOT open file %s!", input.c_str());
 			}
-
-			neb::CJsonObject oJson;
-			oJson.Add("3mxVersion", 1);
-			oJson.Add("name", "Root");
-			oJson.Add("description", "Converted by ProjSEED/To3mx, copyright <a href='https://github.com/ProjSEED/To3mx' target='_blank'>ProjSEED</a>.");
-			oJson.Add("logo", "logo.png");
-
-			neb::CJsonObject oJsonSceneOption;
-			oJsonSceneOption.Add("navigationMode", "ORBIT");
-			oJson.AddEmptySubArray("sceneOptions");
-			oJson["sceneOptions"].Add(oJsonSceneOption);
-
-			neb::CJsonObject oJsonLayer;
-			oJsonLayer.Add("type", "meshPyramid");
-			oJsonLayer.Add("id", "mesh0");
-			oJsonLayer.Add("name", "Root");
-			oJsonLayer.Add("description", "Converted by ProjSEED/To3mx, copyright <a href='https://github.com/ProjSEED/To3mx' target='_blank'>ProjSEED</a>.");
-			oJsonLayer.Add("SRS", srs);
-			oJsonLayer.AddEmptySubArray("SRSOrigin");
-			oJsonLayer["SRSOrigin"].Add(srsOrigin.x());
-			oJsonLayer["SRSOrigin"].Add(srsOrigin.y());
-			oJsonLayer["SRSOrigin"].Add(srsOrigin.z());
-			oJsonLayer.Add("root", outputDataRootRelative);
-			oJson.AddEmptySubArray("layers");
-			oJson["layers"].Add(oJsonLayer);
-
-			std::ofstream outfile(output);
-			if (outfile.bad())
-			{
-				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", output.c_str());
-				return false;
-			}
-			outfile << oJson.ToFormattedString();
-			if (outfile.bad())
-			{
-				seed::log::DumpLog(seed::log::Critical, "An error has occurred while writing file %s!", output.c_str());
-				return false;
-			}
-			return true;
 		}
 
-		bool OsgTo3mx::ConvertTile(const std::string& inputData, const std::string& outputData, const std::string& tileName, osg::BoundingBox& bb)
+		bool OsgTo3mx::ConvertTile(const std::string& inputData, const TileFiles& files, osg::BoundingBox& bb)
 		{
+			const std::string& tileName = files.name;
+			const std::vector<std::string>& baseNames = files.baseNames;
+			const std::vector<unsigned long long>& bytes = files.bytes;
 			std::string inputTile = inputData + tileName + "/";
-			std::string outputTile = outputData + tileName + "/";
-			if (!utils::CheckOrCreateFolder(outputTile))
+			for (auto& backend : _backends)
 			{
-				seed::log::DumpLog(seed::log::Critical, "Create folder %s failed!", outputTile.c_str());
-				return false;
-			}
-			// top level
-			{
-				std::string inputOsgb = inputTile + tileName + ".osgb";
-				std::string output3mxb = outputTile + tileName + ".3mxb";
-				if (!ConvertOsgbTo3mxb(inputOsgb, output3mxb, &bb))
+				if (!backend->BeginTile(tileName))
 				{
-					seed::log::DumpLog(seed::log::Critical, "Convert %s failed!", inputOsgb.c_str());
-					return false;
-				}
-			}
-			// all other
-			osgDB::DirectoryContents fileNames = osgDB::getDirectoryContents(inputTile);
-			osgDB::DirectoryContents osgbFileNames;
-			std::vector<int> indices;
-			std::vector<int> flags;
-			int count = 0;
-			for each (std::string file in fileNames)
-			{
-				std::string ext = osgDB::getLowerCaseFileExtension(file);
-				if (ext != "osgb")
-					continue;
-
-				std::string baseName = osgDB::getNameLessExtension(file);
-				if (baseName == tileName)
-					continue;
+					return false;
+				}
+			}
+			seed::log::DumpLog(seed::log::Debug, "Found %d files in %s...", (int)baseNames.size(), inputTile.c_str());
 
-				osgbFileNames.push_back(file);
-				indices.push_back(count);
-				flags.push_back(0);
-				count++;
+			// Longest processing time first: the most expensive files are dispatched first, and each
+			// worker claims the next file as soon as it is done, so no big file starts at the end.
+			size_t count = baseNames.size();
+			std::vector<double> costs(count);
+			std::vector<size_t> order(count);
+			for (size_t i = 0; i < count; ++i)
+			{
+				costs[i] = EstimateCost(tileName + "/" + baseNames[i], bytes[i]);
+				order[i] = i;
 			}
-			seed::log::DumpLog(seed::log::Debug, "Found %d files in %s...", osgbFileNames.size(), inputTile.c_str());
+			std::stable_sort(order.begin(), order.end(), [&costs](size_t a, size_t b) { return costs[a] > costs[b]; });
 
-#if _HAS_CXX17 && !_DEBUG
-			std::for_each(std::execution::par_unseq, std::begin(indices), std::end(indices), [&](int i)
-#else
-			std::for_each(std::begin(indices), std::end(indices), [&](int i)
-#endif
+			std::vector<int> flags(count, 0);
+			Proxy proxy;
+			std::atomic<size_t> next(0);
+			size_t workers = std::min<size_t>(count, _threads ? _threads : std::max(1u, std::thread::hardware_concurrency()));
+			ParallelFor(workers, [&](size_t)
 				{
-					std::string file = osgbFileNames[i];
-					std::string baseName = osgDB::getNameLessExtension(file);
-					std::string inputOsgb = inputTile + baseName + ".osgb";
-					std::string output3mxb = outputTile + baseName + ".3mxb";
-
-					if (!ConvertOsgbTo3mxb(inputOsgb, output3mxb))
+					for (size_t k = next++; k < count; k = next++)
 					{
-						flags[i] = 1;
-						seed::log::DumpLog(seed::log::Critical, "Convert %s failed!", inputOsgb.c_str());
+						size_t i = order[k];
+						std::string inputOsgb = inputTile + baseNames[i] + ".osgb";
+						auto start = std::chrono::steady_clock::now();
+						bool top = i == 0;
+						if (!ConvertOsgb(inputOsgb, tileName, baseNames[i], top ? &bb : nullptr, top && _coarseLod ? &proxy : nullptr))
+						{
+							flags[i] = 1;
+							seed::log::DumpLog(seed::log::Critical, "Convert %s failed!", inputOsgb.c_str());
+							continue;
+						}
+						std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+						std::lock_guard<std::mutex> lock(_timingsMutex);
+						Timing& timing = _timings[tileName + "/" + baseNames[i]];
+						timing.bytes = bytes[i];
+						timing.seconds = elapsed.count();
 					}
 				}
 			);
-			for (int i = 0; i < flags.size(); ++i)
+			for (size_t i = 0; i < flags.size(); ++i)
 			{
 				if (flags[i])
+				{
+					return false;
+				}
+			}
+			for (auto& backend : _backends)
+			{
+				if (!backend->EndTile(tileName))
 				{
 					return false;
 				}
 			}
+			if (!proxy.mesh.indices.empty())
+			{
+				_proxies[tileName] = std::move(proxy);
+			}
 			return true;
+		}
+
+		static unsigned long long DecodedBytes(const std::vector<Resource>& resourcesGeometry, const std::vector<Resource>& resourcesTexture)
+		{
+			unsigned long long bytes = 0;
+			for (const auto& resource : resourcesGeometry)
+			{
+				const Mesh& mesh = resource.mesh;
+				bytes += (mesh.vertices.size() + mesh.normals.size() + mesh.uvs.size()) * sizeof(float)
+					+ mesh.colors.size() + mesh.indices.size() * sizeof(unsigned int);
+			}
+			for (const auto& resource : resourcesTexture)
+			{
+				bytes += resource.image.pixels.size();
+			}
+			return bytes;
+		}
+
+		// recorded seconds when known, else the size times the average recorded rate
+		double OsgTo3mx::EstimateCost(const std::string& key, unsigned long long bytes)
+		{
+			auto found = _previousTimings.find(key);
+			if (found != _previousTimings.end())
+			{
+				return found->second.seconds;
+			}
+			return bytes * _secondsPerByte;
+		}
+
+		// one "tile/file<TAB>bytes<TAB>seconds" line per file
+		static void LoadTimings(const std::string& path, std::map<std::string, std::pair<unsigned long long, double>>& timings)
+		{
+			std::ifstream infile(path);
+			std::string line;
+			while (std::getline(infile, line))
+			{
+				std::stringstream lineStream(line);
+				std::string key;
+				unsigned long long bytes = 0;
+				double seconds = 0;
+				if (std::getline(lineStream, key, '\t') && lineStream >> bytes >> seconds)
+				{
+					timings[key] = std::make_pair(bytes, seconds);
+				}
+			}
+		}
+
+		void OsgTo3mx::ReadTimings()
+		{
+			_previousTimings.clear();
+			_timings.clear();
+			_secondsPerByte = 1e-8;
+			if (_timingsFile.empty() || !seed::utils::FileExists(_timingsFile))
+			{
+				return;
+			}
+			std::map<std::string, std::pair<unsigned long long, double>> timings;
+			LoadTimings(_timingsFile, timings);
+			double totalSeconds = 0;
+			double totalBytes = 0;
+			for (const auto& entry : timings)
+			{
+				Timing& timing = _previousTimings[entry.first];
+				timing.bytes = entry.second.first;
+				timing.seconds = entry.second.second;
+				totalSeconds += timing.seconds;
+				totalBytes += (double)timing.bytes;
+			}
+			if (totalSeconds > 0 && totalBytes > 0)
+			{
+				_secondsPerByte = totalSeconds / totalBytes;
+			}
+			seed::log::DumpLog(seed::log::Debug, "Read %d timings from %s", (int)_previousTimings.size(), _timingsFile.c_str());
+		}
+
+		// The file is shared by the runs converting part of the tiles (--tiles, --shard, queue
+		// workers): it is read again and only the files converted by this run are replaced, then
+		// it is replaced at once by renaming a temporary file.
+		void OsgTo3mx::WriteTimings()
+		{
+			if (_timingsFile.empty() || _timings.empty())
+			{
+				return;
+			}
+			std::map<std::string, std::pair<unsigned long long, double>> timings;
+			LoadTimings(_timingsFile, timings);
+			for (const auto& timing : _timings)
+			{
+				timings[timing.first] = std::make_pair(timing.second.bytes, timing.second.seconds);
+			}
+
+			std::random_device random;
+			std::string temporary = _timingsFile + "." + std::to_string(random()) + ".tmp";
+			{
+				std::ofstream outfile(temporary);
+				for (const auto& timing : timings)
+				{
+					outfile << timing.first << '\t' << timing.second.first << '\t' << timing.second.second << '\n';
+				}
+				if (!outfile.good())
+				{
+					seed::log::DumpLog(seed::log::Warning, "Can NOT write file %s!", temporary.c_str());
+					return;
+				}
+			}
+			std::error_code ec;
+			std::experimental::filesystem::rename(temporary, _timingsFile, ec);
+			if (ec)
+			{
+				seed::log::DumpLog(seed::log::Warning, "Can NOT replace file %s!", _timingsFile.c_str());
+				std::experimental::filesystem::remove(temporary, ec);
+			}
 		}
 
 		void OsgTo3mx::ParsePagedLOD(const std::string& input, osg::PagedLOD* lod, Node& node, std::vector<Resource>& resourcesGeometry, std::vector<Resource>& resourcesTexture)
@@ -311,14 +1093,19 @@ namespace seed
 			if (lod->getNumFileNames() >= 2)
 			{
 				std::string baseName = osgDB::getNameLessExtension(lod->getFileName(1));
-				node.children.push_back(baseName + ".3mxb");
+				node.children.push_back(baseName);
 			}
 			else if (lod->getRangeList().size() == 1)
 			{
 				std::string baseName = osgDB::getNameLessExtension(lod->getFileName(0));
-				node.children.push_back(baseName + ".3mxb");
+				node.children.push_back(baseName);
 			}
-			
+
+			// before the geometry is parsed: releasing its arrays dirties the bound
+			osg::BoundingBox bb;
+			bb.expandBy(lod->getBound());
+			node.bb = bb;
+
 			if (lod->getNumChildren())
 			{
 				if (lod->getNumChildren() > 1)
@@ -332,9 +1119,6 @@ namespace seed
 				}
 			}
 
-			osg::BoundingBox bb;
-			bb.expandBy(lod->getBound());
-			node.bb = bb;
 			if (lod->getRangeList().size() >= 2)
 			{
 				node.maxScreenDiameter = lod->getRangeList()[1].first;
@@ -361,51 +1145,316 @@ namespace seed
 			geode->accept(infoVisitor);
 			std::map<osg::Texture*, std::string> texture_id_map;
 
+			// Resources and their ids are laid out first, in order, then decoded in parallel:
+			// a single heavy file can use the whole pool and the output does not depend on scheduling.
+
 			// handle texture
-			for (auto tex : infoVisitor.texture_array)
+			size_t firstTexture = resourcesTexture.size();
+			const std::vector<osg::Texture*>& textures = infoVisitor.texture_array;
+			resourcesTexture.resize(firstTexture + textures.size());
+			for (size_t i = 0; i < textures.size(); ++i)
 			{
-				Resource resTexture;
+				Resource& resTexture = resourcesTexture[firstTexture + i];
 				resTexture.type = "textureBuffer";
 				resTexture.format = "jpg";
-				resTexture.id = "texture" + std::to_string(resourcesTexture.size());
-				texture_id_map[tex] = resTexture.id;
-				TextureToBuffer(input, tex, resTexture.bufferData);
-
-				resourcesTexture.emplace_back(resTexture);
+				resTexture.id = "texture" + std::to_string(firstTexture + i);
+				texture_id_map[textures[i]] = resTexture.id;
+			}
+			std::vector<char> owned(textures.size());
+			for (size_t i = 0; i < textures.size(); ++i)
+			{
+				owned[i] = IsTextureOwned(textures[i], infoVisitor.texture_map);
 			}
+			ParallelFor(textures.size(), [&](size_t i)
+				{
+					TextureToImage(input, textures[i], resourcesTexture[firstTexture + i].image);
+					if (owned[i])
+					{
+						textures[i]->setImage(0, nullptr);
+					}
+				}, _threads != 1
+			);
 
 			// handle geometry
+			size_t firstGeometry = resourcesGeometry.size();
+			std::vector<std::pair<osg::Geometry*, int>> geometries;
 			for (auto g : infoVisitor.geometry_array)
 			{
 				int gl_type = FindGeometryType(g);
-				if (gl_type == 0) // tri-mesh
+				if (gl_type != 0 && gl_type != 1)
+					continue;
+
+				Resource resGeometry;
+				resGeometry.type = "geometryBuffer";
+				resGeometry.format = gl_type == 0 ? "ctm" : "xyz"; // tri-mesh or point-cloud
+				resGeometry.id = "geometry" + std::to_string(resourcesGeometry.size());
+				if (gl_type == 0 && infoVisitor.texture_map[g])
 				{
-					Resource resGeometry;
-					resGeometry.type = "geometryBuffer";
-					resGeometry.format = "ctm";
-					resGeometry.id = "geometry" + std::to_string(resourcesGeometry.size());
-					if (infoVisitor.texture_map[g])
+					resGeometry.texture = texture_id_map[infoVisitor.texture_map[g]];
+				}
+				resGeometry.bb = bb;
+
+				resourcesGeometry.emplace_back(resGeometry);
+				node.resources.push_back(resGeometry.id);
+				geometries.emplace_back(g, gl_type);
+			}
+			ParallelFor(geometries.size(), [&](size_t i)
+				{
+					Mesh& mesh = resourcesGeometry[firstGeometry + i].mesh;
+					if (geometries[i].second == 0)
 					{
-						resGeometry.texture = texture_id_map[infoVisitor.texture_map[g]];
+						GeometryTriMeshToMesh(input, geometries[i].first, bb.center(), mesh);
+						if (_weldVertices)
+						{
+							WeldMesh(mesh, _weldTolerance);
+						}
 					}
-					resGeometry.bb = bb;
-					GeometryTriMeshToBuffer(input, g, resGeometry.bufferData);
-
-					resourcesGeometry.emplace_back(resGeometry);
-					node.resources.push_back(resGeometry.id);
-				}
-				else if (gl_type == 1) // point-cloud
+					else
+					{
+						GeometryPointCloudToMesh(input, geometries[i].first, bb.center(), mesh);
+					}
+					ReleaseGeometryData(geometries[i].first);
+				}, _threads != 1
+			);
+
+			if (_atlasTextures)
+			{
+				PackTextures(resourcesGeometry, firstGeometry, resourcesTexture, firstTexture);
+			}
+			if (_mergeGeometries)
+			{
+				MergeGeometries(node, resourcesGeometry, firstGeometry);
+			}
+		}
+
+		// Pack the small textures of a node into as few power-of-two atlases as possible and
+		// remap the uv of the geometries using them. Textures larger than half an atlas, or
+		// used with uv outside [0, 1] (wrapping), keep their own resource.
+		void OsgTo3mx::PackTextures(std::vector<Resource>& resourcesGeometry, size_t firstGeometry, std::vector<Resource>& resourcesTexture, size_t firstTexture)
+		{
+			const int padding = 2;
+			size_t textureCount = resourcesTexture.size() - firstTexture;
+			if (textureCount < 2)
+			{
+				return;
+			}
+
+			std::map<std::string, size_t> textureIndex;
+			for (size_t i = firstTexture; i < resourcesTexture.size(); ++i)
+			{
+				textureIndex[resourcesTexture[i].id] = i - firstTexture;
+			}
+
+			std::vector<char> packable(textureCount, 1);
+			for (size_t i = 0; i < textureCount; ++i)
+			{
+				const Image& image = resourcesTexture[firstTexture + i].image;
+				if (image.pixels.empty() || std::max(image.width, image.height) + padding * 2 > AtlasMaxSize / 2)
 				{
-					Resource resGeometry;
-					resGeometry.type = "geometryBuffer";
-					resGeometry.format = "xyz";
-					resGeometry.id = "geometry" + std::to_string(resourcesGeometry.size());
-					resGeometry.bb = bb;
-					GeometryPointCloudToBuffer(input, g, resGeometry.bufferData);
-
-					resourcesGeometry.emplace_back(resGeometry);
-					node.resources.push_back(resGeometry.id);
+					packable[i] = 0;
+				}
+			}
+			for (size_t i = firstGeometry; i < resourcesGeometry.size(); ++i)
+			{
+				const Resource& resource = resourcesGeometry[i];
+				auto found = textureIndex.find(resource.texture);
+				if (found == textureIndex.end())
+					continue;
+				for (float uv : resource.mesh.uvs)
+				{
+					if (uv < -1e-3f || uv > 1 + 1e-3f)
+					{
+						packable[found->second] = 0;
+						break;
+					}
+				}
+			}
+
+			// largest first, open a new atlas whenever the next texture does not fit
+			std::vector<size_t> order;
+			for (size_t i = 0; i < textureCount; ++i)
+			{
+				if (packable[i])
+					order.push_back(i);
+			}
+			std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+			{
+				const Image& ia = resourcesTexture[firstTexture + a].image;
+				const Image& ib = resourcesTexture[firstTexture + b].image;
+				return ia.width * ia.height > ib.width * ib.height;
+			});
+
+			// the groups are found on the rects only, each atlas is composed once at the end
+			struct Group
+			{
+				std::vector<size_t> textures;
+				std::vector<const Image*> images;
+				std::vector<AtlasRect> rects;
+				int size = 0;
+			};
+			std::vector<Group> groups;
+			std::vector<AtlasRect> rects;
+			for (size_t i : order)
+			{
+				const Image* image = &resourcesTexture[firstTexture + i].image;
+				bool placed = false;
+				for (auto& group : groups)
+				{
+					group.images.push_back(image);
+					int size = ShelfPack(group.images, AtlasMaxSize, padding, rects);
+					if (size > 0)
+					{
+						group.textures.push_back(i);
+						group.rects.swap(rects);
+						group.size = size;
+						placed = true;
+						break;
+					}
+					group.images.pop_back();
+				}
+				if (!placed)
+				{
+					Group group;
+					group.textures.push_back(i);
+					group.images.push_back(image);
+					groups.emplace_back(std::move(group));
+				}
+			}
+
+			// texture -> (atlas, rect) for groups worth an atlas
+			std::vector<Resource> textures(std::make_move_iterator(resourcesTexture.begin() + firstTexture), std::make_move_iterator(resourcesTexture.end()));
+			resourcesTexture.resize(firstTexture);
+			std::vector<int> atlasOf(textureCount, -1);
+			std::vector<AtlasRect> rectOf(textureCount);
+			std::vector<Image> atlases;
+			for (auto& group : groups)
+			{
+				if (group.textures.size() < 2)
+					continue;
+				// the images moved with their resources
+				for (size_t k = 0; k < group.textures.size(); ++k)
+					group.images[k] = &textures[group.textures[k]].image;
+				Image atlas;
+				ComposeAtlas(group.images, group.rects, group.size, padding, atlas);
+				for (size_t k = 0; k < group.textures.size(); ++k)
+				{
+					atlasOf[group.textures[k]] = (int)atlases.size();
+					rectOf[group.textures[k]] = group.rects[k];
+				}
+				atlases.emplace_back(std::move(atlas));
+			}
+			if (atlases.empty())
+			{
+				resourcesTexture.insert(resourcesTexture.end(), std::make_move_iterator(textures.begin()), std::make_move_iterator(textures.end()));
+				return;
+			}
+
+			// renumber: textures kept as they are, then the atlases
+			std::map<std::string, std::string> newIds;
+			for (size_t i = 0; i < textureCount; ++i)
+			{
+				if (atlasOf[i] >= 0)
+					continue;
+				std::string id = "texture" + std::to_string(resourcesTexture.size());
+				newIds[textures[i].id] = id;
+				textures[i].id = id;
+				resourcesTexture.emplace_back(std::move(textures[i]));
+			}
+			std::vector<std::string> atlasIds;
+			std::vector<int> atlasSizes;
+			for (auto& atlas : atlases)
+			{
+				atlasSizes.push_back(atlas.width);
+				Resource resTexture;
+				resTexture.type = "textureBuffer";
+				resTexture.format = "jpg";
+				resTexture.id = "texture" + std::to_string(resourcesTexture.size());
+				resTexture.image = std::move(atlas);
+				atlasIds.push_back(resTexture.id);
+				resourcesTexture.emplace_back(std::move(resTexture));
+			}
+
+			for (size_t i = firstGeometry; i < resourcesGeometry.size(); ++i)
+			{
+				Resource& resource = resourcesGeometry[i];
+				auto found = textureIndex.find(resource.texture);
+				if (found == textureIndex.end())
+					continue;
+				size_t t = found->second;
+				if (atlasOf[t] < 0)
+				{
+					resource.texture = newIds[resource.texture];
+					continue;
+				}
+				int atlasSize = atlasSizes[atlasOf[t]];
+				resource.texture = atlasIds[atlasOf[t]];
+				std::vector<float>& uvs = resource.mesh.uvs;
+				for (size_t k = 0; k + 1 < uvs.size(); k += 2)
+				{
+					RemapUV(rectOf[t], atlasSize, atlasSize, uvs[k], uvs[k + 1]);
+				}
+			}
+		}
+
+		// Concatenate the tri-meshes of a node that share a texture and the same set of vertex
+		// attributes into one ctm resource. Indices are 32-bit, so the merged mesh has no
+		// 65535 vertex limit.
+		void OsgTo3mx::MergeGeometries(Node& node, std::vector<Resource>& resourcesGeometry, size_t firstGeometry)
+		{
+			std::vector<Resource> parsed(std::make_move_iterator(resourcesGeometry.begin() + firstGeometry), std::make_move_iterator(resourcesGeometry.end()));
+			resourcesGeometry.resize(firstGeometry);
+			node.resources.clear();
+
+			std::map<std::string, size_t> merged;
+			for (auto& resource : parsed)
+			{
+				const Mesh& mesh = resource.mesh;
+				size_t vertexCount = mesh.vertices.size() / 3;
+				bool hasNormals = vertexCount && mesh.normals.size() == vertexCount * 3;
+				bool hasUVs = vertexCount && mesh.uvs.size() == vertexCount * 2;
+				std::string key = resource.texture + (hasNormals ? "|n" : "|") + (hasUVs ? "|t" : "|");
+				auto found = merged.find(key);
+				if (resource.format != "ctm" || found == merged.end())
+				{
+					resource.id = "geometry" + std::to_string(resourcesGeometry.size());
+					if (resource.format == "ctm")
+					{
+						if (!hasNormals)
+							resource.mesh.normals.clear();
+						if (!hasUVs)
+							resource.mesh.uvs.clear();
+						merged[key] = resourcesGeometry.size();
+					}
+					node.resources.push_back(resource.id);
+					resourcesGeometry.emplace_back(std::move(resource));
+					continue;
+				}
+
+				Resource& target = resourcesGeometry[found->second];
+				Mesh& dst = target.mesh;
+				unsigned int base = (unsigned int)(dst.vertices.size() / 3);
+				osg::Vec3d shift = mesh.origin - dst.origin;
+				if (shift == osg::Vec3d(0, 0, 0))
+				{
+					dst.vertices.insert(dst.vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+				}
+				else
+				{
+					for (size_t v = 0; v < mesh.vertices.size(); ++v)
+					{
+						dst.vertices.push_back((float)(mesh.vertices[v] + shift[v % 3]));
+					}
+				}
+				if (hasNormals)
+					dst.normals.insert(dst.normals.end(), mesh.normals.begin(), mesh.normals.end());
+				if (hasUVs)
+					dst.uvs.insert(dst.uvs.end(), mesh.uvs.begin(), mesh.uvs.end());
+				dst.indices.reserve(dst.indices.size() + mesh.indices.size());
+				for (auto index : mesh.indices)
+				{
+					dst.indices.push_back(base + index);
 				}
+				target.bb.expandBy(resource.bb);
 			}
 		}
 
@@ -440,13 +1489,21 @@ namespace seed
 			}
 		}
 
-		bool OsgTo3mx::ConvertOsgbTo3mxb(const std::string& input, const std::string& output, osg::BoundingBox* pbb)
+		bool OsgTo3mx::ConvertOsgb(const std::string& input, const std::string& tileName, const std::string& baseName, osg::BoundingBox* pbb, Proxy* pproxy)
 		{
 			seed::log::DumpLog(seed::log::Debug, "Convert %s ...", input.c_str());
 			std::vector<Node> nodes;
 			std::vector<Resource> resourcesGeometry;
 			std::vector<Resource> resourcesTexture;
-			osg::ref_ptr<osg::Node> osgNode = osgDB::readNodeFile(input);
+			// the scene graph is estimated from the file size until its resources are decoded
+			unsigned long long bytes = _archive ? _archive->FileSize(input) : seed::utils::FileSize(input);
+			MemoryReservation reservation(_memoryBudget, bytes * OsgbMemoryFactor);
+			osg::ref_ptr<osg::Node> osgNode = _archive ? _archive->ReadNode(input) : osgDB::readRefNodeFile(input);
+			if (!osgNode)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT read file %s!", input.c_str());
+				return false;
+			}
 			if (dynamic_cast<osg::PagedLOD*>(osgNode.get()))
 			{
 				osg::PagedLOD* lod = dynamic_cast<osg::PagedLOD*>(osgNode.get());
@@ -486,134 +1543,55 @@ namespace seed
 				nodes.push_back(node);
 			}
 
+			// everything needed is decoded: free the scene graph before encoding and writing
+			osgNode = nullptr;
+
 			if (pbb && nodes.size())
 			{
 				*pbb = nodes[0].bb;
 			}
+
+			// the decoded resources and the buffers encoded from them
+			reservation.Resize(DecodedBytes(resourcesGeometry, resourcesTexture) * 2);
 
 			if (nodes.empty())
 			{
 				seed::log::DumpLog(seed::log::Warning, "Extract 0 node from %s", input.c_str());
 				return false;
-			}
-
-			if(!Generate3mxb(nodes, resourcesGeometry, resourcesTexture, output))
-			{
-				seed::log::DumpLog(seed::log::Critical, "Generate %s failed!", output.c_str());
-				return false;
-			}
-
-			return true;
-		}
-
-		bool OsgTo3mx::Generate3mxb(const std::vector<Node>& nodes, const std::vector<Resource>& resourcesGeometry, const std::vector<Resource>& resourcesTexture, const std::string& output)
-		{
-			neb::CJsonObject oJson;
-			oJson.Add("version", 1);
-
-			oJson.AddEmptySubArray("nodes");
-			for (const auto& node : nodes)
-			{
-				oJson["nodes"].Add(NodeToJson(node));
-			}
-
-			oJson.AddEmptySubArray("resources");
-			for (const auto& resource : resourcesTexture)
-			{
-				oJson["resources"].Add(ResourceToJson(resource));
-			}
-			for (const auto& resource : resourcesGeometry)
-			{
-				oJson["resources"].Add(ResourceToJson(resource));
-			}
-
-			std::string jsonStr = oJson.ToString();
-			uint32_t length = jsonStr.size();
-
-			std::ofstream outfile(output, std::ios::out | std::ios::binary);
-			if (outfile.bad())
-			{
-				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", output.c_str());
-				return false;
 			}
 
-			outfile.write("3MXBO", 5);
-			outfile.write((char*)&length, 4);
-			outfile.write(jsonStr.c_str(), length);
-
-			for (const auto& resource : resourcesTexture)
-			{
-				outfile.write(resource.bufferData.data(), resource.bufferData.size());
-			}
-			for (const auto& resource : resourcesGeometry)
-			{
-				outfile.write(resource.bufferData.data(), resource.bufferData.size());
-			}
-
-			if (outfile.bad())
-			{
-				seed::log::DumpLog(seed::log::Critical, "An error has occurred while writing file %s!", output.c_str());
-				return false;
-			}
-			return true;
-		}
-
-		neb::CJsonObject OsgTo3mx::NodeToJson(const Node& node)
-		{
-			neb::CJsonObject oJson;
-			oJson.Add("id", node.id);
-
-			oJson.AddEmptySubArray("bbMin");
-			oJson["bbMin"].Add(node.bb.xMin());
-			oJson["bbMin"].Add(node.bb.yMin());
-			oJson["bbMin"].Add(node.bb.zMin());
-
-			oJson.AddEmptySubArray("bbMax");
-			oJson["bbMax"].Add(node.bb.xMax());
-			oJson["bbMax"].Add(node.bb.yMax());
-			oJson["bbMax"].Add(node.bb.zMax());
-
-			oJson.Add("maxScreenDiameter", node.maxScreenDiameter);
-
-			oJson.AddEmptySubArray("children");
-			for (auto child : node.children)
-			{
-				oJson["children"].Add(child);
-			}
-
-			oJson.AddEmptySubArray("resources");
-			for (auto resource : node.resources)
-			{
-				oJson["resources"].Add(resource);
+			if (pproxy)
+			{
+				std::map<std::string, const Image*> textureMap;
+				for (const auto& resource : resourcesTexture)
+				{
+					textureMap[resource.id] = &resource.image;
+				}
+				std::vector<const Mesh*> meshes;
+				std::vector<const Image*> textures;
+				for (const auto& resource : resourcesGeometry)
+				{
+					if (resource.format != "ctm")
+						continue;
+					meshes.push_back(&resource.mesh);
+					textures.push_back(resource.texture.empty() ? nullptr : textureMap[resource.texture]);
+				}
+				if (!meshes.empty() && !BuildProxy(meshes, textures, TileProxyTextureSize, TileProxyTriangles, *pproxy))
+				{
+					seed::log::DumpLog(seed::log::Warning, "Build coarse LOD proxy of %s failed.", input.c_str());
+				}
 			}
-			return oJson;
-		}
 
-		neb::CJsonObject OsgTo3mx::ResourceToJson(const Resource& resource)
-		{
-			neb::CJsonObject oJson;
-			oJson.Add("type", resource.type);
-			oJson.Add("format", resource.format);
-			oJson.Add("id", resource.id);
-			if (resource.type == "geometryBuffer")
+			for (auto& backend : _backends)
 			{
-				if (resource.format == "ctm")
+				if (!backend->WriteFile(tileName, baseName, nodes, resourcesGeometry, resourcesTexture))
 				{
-					oJson.Add("texture", resource.texture);
+					seed::log::DumpLog(seed::log::Critical, "Generate %s output of %s failed!", backend->Name(), input.c_str());
+					return false;
 				}
-
-				oJson.AddEmptySubArray("bbMin");
-				oJson["bbMin"].Add(resource.bb.xMin());
-				oJson["bbMin"].Add(resource.bb.yMin());
-				oJson["bbMin"].Add(resource.bb.zMin());
-
-				oJson.AddEmptySubArray("bbMax");
-				oJson["bbMax"].Add(resource.bb.xMax());
-				oJson["bbMax"].Add(resource.bb.yMax());
-				oJson["bbMax"].Add(resource.bb.zMax());
 			}
-			oJson.Add("size", resource.bufferData.size());
-			return oJson;
+
+			return true;
 		}
 
 		int OsgTo3mx::FindGeometryType(osg::Geometry* geometry)
@@ -627,7 +1605,7 @@ namespace seed
 				osg::PrimitiveSet* ps = geometry->getPrimitiveSet(k);
 				osg::PrimitiveSet::Type t = ps->getType();
 				auto mode = ps->getMode();
-				if (mode == GL_TRIANGLES)
+				if (IsTriangleMode(mode))
 				{
 					if (k == 0)
 					{
@@ -657,39 +1635,33 @@ namespace seed
 			return type;
 		}
 
-		void OsgTo3mx::GeometryTriMeshToBuffer(const std::string& input, osg::Geometry* geometry, std::vector<char>& bufferData)
+		void OsgTo3mx::GeometryTriMeshToMesh(const std::string& input, osg::Geometry* geometry, const osg::Vec3d& origin, Mesh& mesh)
 		{
 			if (geometry->getNumPrimitiveSets() == 0) {
 				return;
 			}
 
-			std::vector<CTMuint> aIndices;
-			std::vector<CTMfloat> aVertices;
-			std::vector<CTMfloat> aNormals;
-			std::vector<CTMfloat> aUVCoords;
+			std::vector<unsigned int>& aIndices = mesh.indices;
+			std::vector<float>& aVertices = mesh.vertices;
+			std::vector<float>& aNormals = mesh.normals;
+			std::vector<float>& aUVCoords = mesh.uvs;
 
 			// indc
 			{
-				int idx_size = 0;
-				osg::PrimitiveSet::Type t_max = osg::PrimitiveSet::DrawElementsUBytePrimitiveType;
+				size_t triangleCount = 0;
 				for (uint32 k = 0; k < geometry->getNumPrimitiveSets(); k++)
 				{
-					osg::PrimitiveSet* ps = geometry->getPrimitiveSet(k);
-					osg::PrimitiveSet::Type t = ps->getType();
-					if ((int)t > (int)t_max)
-					{
-						t_max = t;
-					}
-					idx_size += ps->getNumIndices();
+					triangleCount += CountTriangles(geometry->getPrimitiveSet(k));
 				}
+				aIndices.reserve(triangleCount * 3);
 
 				for (uint32 k = 0; k < geometry->getNumPrimitiveSets(); k++)
 				{
 					osg::PrimitiveSet* ps = geometry->getPrimitiveSet(k);
 					osg::PrimitiveSet::Type t = ps->getType();
 					auto mode = ps->getMode();
-					if (mode != GL_TRIANGLES) {
-						seed::log::DumpLog(seed::log::Warning, "Found none-GL_TRIANGLES primitive set in file %s, none-GL_TRIANGLES primitive set will be ignored.", input.c_str());
+					if (!IsTriangleMode(mode)) {
+						seed::log::DumpLog(seed::log::Warning, "Found none-triangle primitive set in file %s, none-triangle primitive set will be ignored.", input.c_str());
 						continue;
 					}
 
@@ -698,45 +1670,34 @@ namespace seed
 					case(osg::PrimitiveSet::DrawElementsUBytePrimitiveType):
 					{
 						const osg::DrawElementsUByte* drawElements = static_cast<const osg::DrawElementsUByte*>(ps);
-						int IndNum = drawElements->getNumIndices();
-						for (size_t m = 0; m < IndNum; m++)
-						{
-							aIndices.push_back(drawElements->at(m));
-						}
+						AppendTriangles(mode, drawElements->size(), [drawElements](unsigned int i) { return (unsigned int)(*drawElements)[i]; }, aIndices);
 						break;
 					}
 					case(osg::PrimitiveSet::DrawElementsUShortPrimitiveType):
 					{
 						const osg::DrawElementsUShort* drawElements = static_cast<const osg::DrawElementsUShort*>(ps);
-						int IndNum = drawElements->getNumIndices();
-						for (size_t m = 0; m < IndNum; m++)
-						{
-							aIndices.push_back(drawElements->at(m));
-						}
+						AppendTriangles(mode, drawElements->size(), [drawElements](unsigned int i) { return (unsigned int)(*drawElements)[i]; }, aIndices);
 						break;
 					}
 					case(osg::PrimitiveSet::DrawElementsUIntPrimitiveType):
 					{
 						const osg::DrawElementsUInt* drawElements = static_cast<const osg::DrawElementsUInt*>(ps);
-						unsigned int IndNum = drawElements->getNumIndices();
-						for (size_t m = 0; m < IndNum; m++)
-						{
-							aIndices.push_back(drawElements->at(m));
-						}
+						AppendTriangles(mode, drawElements->size(), [drawElements](unsigned int i) { return (*drawElements)[i]; }, aIndices);
 						break;
 					}
 					case osg::PrimitiveSet::DrawArraysPrimitiveType: {
-						osg::DrawArrays* da = dynamic_cast<osg::DrawArrays*>(ps);
-						if (k == 0) {
-							int first = da->getFirst();
-							int count = da->getCount();
-							int max_num = first + count;
-							if (max_num >= 65535) {
-								max_num = 65535; idx_size = 65535;
-							}
-							for (int i = first; i < max_num; i++) {
-								aIndices.push_back(i);
-							}
+						const osg::DrawArrays* da = static_cast<const osg::DrawArrays*>(ps);
+						unsigned int first = da->getFirst();
+						AppendTriangles(mode, da->getCount(), [first](unsigned int i) { return first + i; }, aIndices);
+						break;
+					}
+					case osg::PrimitiveSet::DrawArrayLengthsPrimitiveType: {
+						const osg::DrawArrayLengths* dal = static_cast<const osg::DrawArrayLengths*>(ps);
+						unsigned int first = dal->getFirst();
+						for (auto length : *dal)
+						{
+							AppendTriangles(mode, length, [first](unsigned int i) { return first + i; }, aIndices);
+							first += length;
 						}
 						break;
 					}
@@ -749,106 +1710,59 @@ namespace seed
 				}
 			}
 			osg::Array* va = geometry->getVertexArray();
-			osg::Vec3Array* v3f = (osg::Vec3Array*)va;
-			int vec_size = v3f->size();
-			for (int vidx = 0; vidx < vec_size; vidx++)
+			size_t vertexCount = va ? va->getNumElements() : 0;
+			// positions relative to the node center keep their precision as floats
+			mesh.origin = origin;
+			if (!ConvertArray(va, vertexCount, 3, false, aVertices, &origin))
 			{
-				osg::Vec3f point = v3f->at(vidx);
-				aVertices.push_back(point.x());
-				aVertices.push_back(point.y());
-				aVertices.push_back(point.z());
+				seed::log::DumpLog(seed::log::Warning, "Unsupported vertex array in file %s, geometry will be ignored.", input.c_str());
+				aIndices.clear();
+				return;
 			}
 			// normal
-			int normal_size = 0;
 			osg::Array* na = geometry->getNormalArray();
-			if (na)
+			if (na && !ConvertArray(na, vertexCount, 3, true, aNormals))
 			{
-				osg::Vec3Array* v3f = (osg::Vec3Array*)na;
-				normal_size = v3f->size();
-				for (int vidx = 0; vidx < normal_size; vidx++)
-				{
-					osg::Vec3f point = v3f->at(vidx);
-					aNormals.push_back(point.x());
-					aNormals.push_back(point.y());
-					aNormals.push_back(point.z());
-				}
+				seed::log::DumpLog(seed::log::Warning, "Unsupported normal array or binding in file %s, normals will be ignored.", input.c_str());
 			}
 			// texture
-			int texture_size = 0;
 			osg::Array* ta = geometry->getTexCoordArray(0);
-			if (ta) {
-				osg::Vec2Array* v2f = (osg::Vec2Array*)ta;
-				texture_size = v2f->size();
-				for (int vidx = 0; vidx < texture_size; vidx++)
-				{
-					osg::Vec2f point = v2f->at(vidx);
-					aUVCoords.push_back(point.x());
-					aUVCoords.push_back(point.y());
-				}
+			if (ta && !ConvertArray(ta, vertexCount, 2, false, aUVCoords))
+			{
+				seed::log::DumpLog(seed::log::Warning, "Unsupported texture coordinate array or binding in file %s, texture coordinates will be ignored.", input.c_str());
 			}
-
-			CTMexporter ctm;
-			ctm.DefineMesh(aVertices.data(), aVertices.size() / 3, aIndices.data(), aIndices.size() / 3, aNormals.data());
-			ctm.AddUVMap(aUVCoords.data(), nullptr, nullptr);
-			ctm.SaveCustom(_ctm_write_buf, &bufferData);
 		}
 
-		void OsgTo3mx::GeometryPointCloudToBuffer(const std::string& input, osg::Geometry* geometry, std::vector<char>& bufferData)
+		void OsgTo3mx::GeometryPointCloudToMesh(const std::string& input, osg::Geometry* geometry, const osg::Vec3d& origin, Mesh& mesh)
 		{
 			if (geometry->getNumPrimitiveSets() == 0) {
 				return;
 			}
 
-			std::vector<float> aVertices;
-			std::vector<char> aColors;
+			std::vector<float>& aVertices = mesh.vertices;
+			std::vector<unsigned char>& aColors = mesh.colors;
 
 			osg::Array* va = geometry->getVertexArray();
-			int vec_size = 0;
-			if (va)
+			size_t vertexCount = va ? va->getNumElements() : 0;
+			// positions relative to the node center keep their precision as floats
+			mesh.origin = origin;
+			if (!ConvertArray(va, vertexCount, 3, false, aVertices, &origin))
 			{
-				osg::Vec3Array* v3f = (osg::Vec3Array*)va;
-				vec_size = v3f->size();
-				for (int vidx = 0; vidx < vec_size; vidx++)
-				{
-					osg::Vec3f point = v3f->at(vidx);
-					aVertices.push_back(point.x());
-					aVertices.push_back(point.y());
-					aVertices.push_back(point.z());
-				}
+				seed::log::DumpLog(seed::log::Warning, "Unsupported vertex array in file %s, point-cloud will be ignored.", input.c_str());
+				return;
 			}
 
 			// color
 			osg::Array* ca = geometry->getColorArray();
-			int color_size;
-			if (ca)
+			if (ca && !ConvertColorArray(ca, vertexCount, aColors))
 			{
-				osg::Vec4Array* v4f = (osg::Vec4Array*)ca;
-				color_size = v4f->size();
-				for (int vidx = 0; vidx < color_size; vidx++)
-				{
-					osg::Vec4f point = v4f->at(vidx);
-					aColors.push_back(char(point.x() * 255));
-					aColors.push_back(char(point.y() * 255));
-					aColors.push_back(char(point.z() * 255));
-					aColors.push_back(char(point.w() * 255));
-				}
+				seed::log::DumpLog(seed::log::Warning, "Unsupported color array or binding in file %s, colors will be ignored.", input.c_str());
 			}
-
-			if (vec_size == 0) {
-				return;
-			}
-			if (vec_size != color_size) {
-				return;
-			}
-
-			bufferData.insert(bufferData.end(), (char*)&vec_size, (char*)&vec_size + 4);
-			bufferData.insert(bufferData.end(), (char*)aVertices.data(), (char*)aVertices.data() + sizeof(float) * aVertices.size());
-			bufferData.insert(bufferData.end(), (char*)aColors.data(), (char*)aColors.data() + sizeof(char) * aColors.size());
 		}
 
-		void OsgTo3mx::TextureToBuffer(const std::string& input, osg::Texture* texture, std::vector<char>& bufferData)
+		void OsgTo3mx::TextureToImage(const std::string& input, osg::Texture* texture, Image& image)
 		{
-			std::vector<unsigned char> jpeg_buf;
+			std::vector<unsigned char>& jpeg_buf = image.pixels;
 			jpeg_buf.reserve(512 * 512 * 3);
 			int width, height, comp;
 			{
@@ -861,6 +1775,7 @@ namespace seed
 							comp = img->getPixelSizeInBits();
 							if (comp == 8) comp = 1;
 							if (comp == 24) comp = 3;
+							if (comp == 32) comp = 4;
 							if (comp == 4) {
 								comp = 3;
 								fill_4BitImage(jpeg_buf, img, width, height);
@@ -887,14 +1802,14 @@ namespace seed
 				}
 			}
 			if (!jpeg_buf.empty()) {
-				bufferData.reserve(width * height * comp);
-				stbi_write_jpg_to_func(write_buf, &bufferData, width, height, comp, jpeg_buf.data(), 80);
+				image.width = width;
+				image.height = height;
+				image.comp = comp;
 			}
 			else {
-				std::vector<char> v_data;
-				width = height = 256;
-				v_data.resize(width * height * 3);
-				stbi_write_jpg_to_func(write_buf, &bufferData, width, height, 3, v_data.data(), 80);
+				image.width = image.height = 256;
+				image.comp = 3;
+				jpeg_buf.assign(image.width * image.height * image.comp, 0);
 			}
 		}
 	}
@@ -1,7 +1,16 @@
 #pragma once
 
 #include "Common.h"
-#include "CJsonObject.hpp"
+#include "model.h"
+#include "outputBackend.h"
+#include "coarseLod.h"
+#include "memoryBudget.h"
+#include "tileQueue.h"
+#include "tileScanner.h"
+#include "inputArchive.h"
+
+#include <map>
+#include <mutex>
 
 #include <osg/BoundingBox>
 #include <osg/ref_ptr>
@@ -25,26 +34,15 @@ namespace seed
 {
 	namespace io
 	{
-		struct Node
+		// subset of the tiles of Data/ converted by one process
+		struct TileSelection
 		{
-			std::string id;
-			osg::BoundingBox bb;
-			float maxScreenDiameter;
-			std::vector<std::string> children;
-			std::vector<std::string> resources;
+			int shardIndex = 0;
+			int shardCount = 1;
+			std::vector<std::string> patterns;	// tile names or globs, empty: all
 		};
 
-		struct Resource
-		{
-			std::string type;
-			std::string format;
-			std::string id;
-			
-			std::string texture;
-			osg::BoundingBox bb;
-
-			std::vector<char> bufferData;
-		};
+		bool ParseTileSelection(const std::string& shard, const std::string& pattern, TileSelection& selection);
 
 		class OsgTo3mx
 		{
@@ -53,27 +51,118 @@ namespace seed
 
 			~OsgTo3mx() {}
 
-			bool Convert(const std::string&input, const std::string& output);
+			// Parse and decode every input file once and write it with every profile. The input is a
+			// folder, or a .zip or .tar archive of it read without extracting it.
+			bool Convert(const std::string& input, const std::vector<OutputProfile>& profiles);
 
-		private:
-			bool ConvertMetadataTo3mx(const std::string& input, const std::string& outputDataRootRelative, const std::string& output);
-			bool ConvertTile(const std::string& inputData, const std::string& outputData, const std::string& tileName, osg::BoundingBox& bb);
-			bool ConvertOsgbTo3mxb(const std::string& input, const std::string& output, osg::BoundingBox* pbb = nullptr);
+			// Convert, then convert again on another thread count to <output>.check and compare the two outputs
+			// byte for byte: the output must not depend on the thread count or the scheduling. The
+			// check folders are removed when identical. Folder outputs only, not packed, and
+			// builds that convert in parallel.
+			bool VerifyDeterminism(const std::string& input, const std::vector<OutputProfile>& profiles);
+
+			// Distributed conversion through a queue folder on a shared file system: create the queue
+			// of tiles once, run any number of workers (processes on any machine, all with the same
+			// input, profiles and options) until it is empty, then merge the root levels once.
+			bool CreateQueue(const std::string& input, const std::string& queueDir);
+			bool ConvertQueue(const std::string& input, const std::vector<OutputProfile>& profiles, const std::string& queueDir);
+			bool MergeQueue(const std::string& input, const std::vector<OutputProfile>& profiles, const std::string& queueDir);
+
+			// Static split for external schedulers: each job converts a deterministic subset of the
+			// tiles and writes their records to recordsDir, one job then writes the root from them.
+			bool ConvertShard(const std::string& input, const std::vector<OutputProfile>& profiles, const TileSelection& selection, const std::string& recordsDir);
+			bool MergeRoot(const std::string& input, const std::vector<OutputProfile>& profiles, const std::string& recordsDir);
+
+			// give the upper levels built above the tiles merged, decimated geometry
+			void EnableCoarseLod(bool enable) { _coarseLod = enable; }
+
+			// pack the small textures of a node into shared atlases
+			void EnableTextureAtlas(bool enable) { _atlasTextures = enable; }
+
+			// write one geometry per texture and node instead of one per osg::Geometry
+			void EnableGeometryMerging(bool enable) { _mergeGeometries = enable; }
+
+			// weld duplicated tri-mesh vertices before encoding, bitwise equal ones with tolerance 0
+			void EnableVertexWelding(bool enable, float tolerance = 0.0f) { _weldVertices = enable; _weldTolerance = tolerance; }
+
+			// schedule files by the durations recorded in this file by a previous run, and record this run's
+			void SetTimingsFile(const std::string& timingsFile) { _timingsFile = timingsFile; }
 
-			bool GenerateMetadata(const std::string& output);
-			bool Generate3mxb(const std::vector<Node>& nodes, const std::vector<Resource>& resourcesGeometry, const std::vector<Resource>& resourcesTexture, const std::string& output);
+			// files converted at once, 0: one per core
+			void SetThreads(size_t threads) { _threads = threads; }
 
-			neb::CJsonObject NodeToJson(const Node& node);
-			neb::CJsonObject ResourceToJson(const Resource& resource);
+			// bytes the files converted at once may take, 0: unlimited
+			void SetMaxMemory(unsigned long long bytes) { _memoryBudget.SetLimit(bytes); }
+
+		private:
+			bool OpenInput(const std::string& input);
+			bool CreateBackends(const std::vector<OutputProfile>& profiles);
+			bool BeginBackends(const std::string& input);
+			void ListTiles(const std::string& inputData, std::vector<std::string>& tiles);
+			Node TileNode(const std::string& tileName, const osg::BoundingBox& bb);
+			bool FinishRoot(const std::string& inputData, std::vector<Node>& nodes);
+			void SelectTiles(const TileSelection& selection, std::vector<std::string>& tiles);
+			bool ConvertRecordedTile(const std::string& inputData, const TileFiles& files, const std::string& recordsDir, TileRecord& record);
+			bool MergeRecords(const std::string& input, const std::vector<OutputProfile>& profiles, const std::vector<TileRecord>& records);
+
+			void ReadMetadata(const std::string& input, Metadata& metadata);
+			bool ConvertTile(const std::string& inputData, const TileFiles& files, osg::BoundingBox& bb);
+			void ReadTimings();
+			void WriteTimings();
+			double EstimateCost(const std::string& key, unsigned long long bytes);
+			bool BuildRootHierarchy(std::vector<Node>& nodes, const std::string& key, std::vector<Resource>& resourcesGeometry, std::vector<Resource>& resourcesTexture);
+			bool BuildNodeProxy(Node& node, const std::vector<Node>& children, std::vector<Resource>& resourcesGeometry, std::vector<Resource>& resourcesTexture);
+			bool ConvertOsgb(const std::string& input, const std::string& tileName, const std::string& baseName, osg::BoundingBox* pbb = nullptr, Proxy* pproxy = nullptr);
 
 			void ParsePagedLOD(const std::string& input, osg::PagedLOD* lod, Node& node, std::vector<Resource>& resourcesGeometry, std::vector<Resource>& resourcesTexture);
 			void ParseGeode(const std::string& input, osg::Geode* geode, Node& node, std::vector<Resource>& resourcesGeometry, std::vector<Resource>& resourcesTexture);
+			void PackTextures(std::vector<Resource>& resourcesGeometry, size_t firstGeometry, std::vector<Resource>& resourcesTexture, size_t firstTexture);
+			void MergeGeometries(Node& node, std::vector<Resource>& resourcesGeometry, size_t firstGeometry);
 			void ParseGroup(const std::string& input, osg::Group* group, std::vector<Node>& nodes, std::vector<Resource>& resourcesGeometry, std::vector<Resource>& resourcesTexture);
 
 			int FindGeometryType(osg::Geometry* geometry); // -1: invalid, 0: tri-mesh, 1: point-cloud
-			void GeometryTriMeshToBuffer(const std::string& input, osg::Geometry* geometry, std::vector<char>& bufferData);
-			void GeometryPointCloudToBuffer(const std::string& input, osg::Geometry* geometry, std::vector<char>& bufferData);
-			void TextureToBuffer(const std::string& input, osg::Texture* texture, std::vector<char>& bufferData);
+			void GeometryTriMeshToMesh(const std::string& input, osg::Geometry* geometry, const osg::Vec3d& origin, Mesh& mesh);
+			void GeometryPointCloudToMesh(const std::string& input, osg::Geometry* geometry, const osg::Vec3d& origin, Mesh& mesh);
+			void TextureToImage(const std::string& input, osg::Texture* texture, Image& image);
+
+		private:
+			// upper level files are added until no root level file has more nodes than this
+			static const size_t MaxRootChildren = 16;
+
+			// proxy budgets: per tile root, and per upper level node
+			static const int AtlasMaxSize = 2048;
+
+			static const int TileProxyTextureSize = 64;
+			static const size_t TileProxyTriangles = 1024;
+			static const int ProxyTextureSize = 512;
+			static const size_t ProxyTriangles = 8192;
+
+			// in-memory size of a scene graph per byte of .osgb (textures are stored compressed)
+			static const unsigned long long OsgbMemoryFactor = 8;
+
+			std::vector<std::shared_ptr<OutputBackend>> _backends;
+			bool _coarseLod = false;
+			bool _atlasTextures = false;
+			bool _mergeGeometries = false;
+			size_t _threads = 0;
+			bool _weldVertices = false;
+			float _weldTolerance = 0.0f;
+			std::shared_ptr<InputArchive> _archive;	// when the input is an archive
+			std::map<std::string, Proxy> _proxies;	// by node id, until merged into the parent level
+
+			// per "tile/file": size in bytes and conversion seconds
+			struct Timing
+			{
+				unsigned long long bytes = 0;
+				double seconds = 0;
+			};
+			std::string _timingsFile;
+			std::map<std::string, Timing> _previousTimings;
+			std::map<std::string, Timing> _timings;
+			double _secondsPerByte = 1e-8;
+			std::mutex _timingsMutex;
+
+			MemoryBudget _memoryBudget;
 		};
 	}
 }
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "outputBackend.h"
+#include "threeMxBackend.h"
+#include "tilesBackend.h"
+#include "storage.h"
+#include "common.h"
+
+#include <sstream>
+
+namespace seed
+{
+	namespace io
+	{
+		std::shared_ptr<OutputBackend> CreateOutputBackend(const OutputProfile& profile)
+		{
+			if (profile.format != "3mx" && profile.format != "3dtiles")
+			{
+				seed::log::DumpLog(seed::log::Critical, "Unknown output format %s!", profile.format.c_str());
+				return nullptr;
+			}
+			auto storage = CreateStorage(profile.output, profile.options.pack);
+			if (!storage)
+			{
+				return nullptr;
+			}
+			if (profile.format == "3mx")
+			{
+				return std::make_shared<ThreeMxBackend>(profile.output, storage, profile.options);
+			}
+			return std::make_shared<TilesBackend>(profile.output, storage, profile.options);
+		}
+
+		bool ParseOutputProfiles(const std::string& text, std::vector<OutputProfile>& profiles)
+		{
+			std::stringstream profilesStream(text);
+			std::string profileText;
+			while (std::getline(profilesStream, profileText, ';'))
+			{
+				if (profileText.empty())
+					continue;
+
+				OutputProfile profile;
+				std::stringstream profileStream(profileText);
+				std::string item;
+				while (std::getline(profileStream, item, ','))
+				{
+					size_t pos = item.find('=');
+					std::string key = item.substr(0, pos);
+					std::string value = pos == std::string::npos ? "1" : item.substr(pos + 1);
+					if (key == "format")
+					{
+						profile.format = value;
+					}
+					else if (key == "output")
+					{
+						profile.output = value;
+					}
+					else if (key == "quality")
+					{
+						profile.options.jpegQuality = atoi(value.c_str());
+					}
+					else if (key == "maxTextureSize")
+					{
+						profile.options.maxTextureSize = atoi(value.c_str());
+					}
+					else if (key == "geometryOnly")
+					{
+						profile.options.geometryOnly = atoi(value.c_str()) != 0;
+					}
+					else if (key == "quantize")
+					{
+						profile.options.quantize = atoi(value.c_str()) != 0;
+					}
+					else if (key == "pack")
+					{
+						profile.options.pack = atoi(value.c_str()) != 0;
+					}
+					else
+					{
+						seed::log::DumpLog(seed::log::Critical, "Unknown profile option %s!", key.c_str());
+						return false;
+					}
+				}
+				if (profile.format.empty() || profile.output.empty())
+				{
+					seed::log::DumpLog(seed::log::Critical, "Profile %s needs a format and an output!", profileText.c_str());
+					return false;
+				}
+				if (profile.options.pack && IsObjectStoreUrl(profile.output))
+				{
+					seed::log::DumpLog(seed::log::Warning, "Objects are not packed, pack is ignored in profile %s.", profileText.c_str());
+					profile.options.pack = false;
+				}
+				if (profile.options.pack && profile.format != "3mx")
+				{
+					seed::log::DumpLog(seed::log::Warning, "Only 3mx output can be packed, profile %s is written to files.", profileText.c_str());
+					profile.options.pack = false;
+				}
+				if (profile.options.jpegQuality < 1 || profile.options.jpegQuality > 100)
+				{
+					seed::log::DumpLog(seed::log::Critical, "Invalid jpeg quality in profile %s!", profileText.c_str());
+					return false;
+				}
+				profiles.push_back(profile);
+			}
+			return !profiles.empty();
+		}
+	}
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "model.h"
+
+#include <memory>
+
+namespace seed
+{
+	namespace io
+	{
+		// codec settings of one output
+		struct EncodeOptions
+		{
+			int jpegQuality = 80;
+			int maxTextureSize = 0;		// 0: keep the source size
+			bool geometryOnly = false;	// drop textures and uv
+			bool quantize = false;		// lossy ctm positions, within a pixel at the node switch distance
+			bool pack = false;			// 3mxb files appended to Pack/*.pack instead of Data/
+			bool parallelPacking = false;	// one thread per ctm stream, set by the converter when files are encoded one at a time
+		};
+
+		// one deliverable of a conversion: format ("3mx" or "3dtiles"), folder (or "s3://bucket/prefix")
+		// and codec settings
+		struct OutputProfile
+		{
+			std::string format;
+			std::string output;
+			EncodeOptions options;
+		};
+
+		// Receives the nodes and decoded resources parsed from the input tree and
+		// writes them in one output format. Begin/BeginTile/EndTile/End are called from the
+		// converting thread, WriteFile may be called concurrently for different files.
+		class OutputBackend
+		{
+		public:
+			virtual ~OutputBackend() {}
+
+			virtual const char* Name() const = 0;
+
+			// create the output folder and the top level metadata
+			virtual bool Begin(const Metadata& metadata) = 0;
+
+			// create the folder of tile Data/<tileName>/
+			virtual bool BeginTile(const std::string& tileName) = 0;
+
+			// write Data/<tileName>/<baseName>.*, or Data/<baseName>.* for an empty tileName,
+			// node children are base names without extension
+			virtual bool WriteFile(const std::string& tileName, const std::string& baseName, const std::vector<Node>& nodes,
+				const std::vector<Resource>& resourcesGeometry, const std::vector<Resource>& resourcesTexture) = 0;
+
+			// wait until the files of the tile are on disk, false if any could not be written
+			virtual bool EndTile(const std::string& tileName) = 0;
+
+			// write the root, children are relative to Data/ ("<tileName>/<tileName>" or an upper level file)
+			virtual bool End(const std::vector<Node>& nodes, const std::vector<Resource>& resourcesGeometry, const std::vector<Resource>& resourcesTexture) = 0;
+		};
+
+		std::shared_ptr<OutputBackend> CreateOutputBackend(const OutputProfile& profile);
+
+		// "format=3mx,output=D:/out,quality=50,maxTextureSize=512,geometryOnly=1,quantize=1,pack=1;format=3dtiles,output=..."
+		bool ParseOutputProfiles(const std::string& text, std::vector<OutputProfile>& profiles);
+	}
+}
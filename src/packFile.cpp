@@ -0,0 +1,166 @@
+#include "packFile.h"
+#include "fileWriter.h"
+#include "common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <experimental/filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+
+namespace fs = std::experimental::filesystem;
+
+namespace seed
+{
+	namespace io
+	{
+		bool PackFile::OpenPart()
+		{
+			ClosePart();
+			if (!seed::utils::CheckOrCreateFolder(_dir))
+			{
+				return false;
+			}
+			_part++;
+			char suffix[16];
+			snprintf(suffix, sizeof(suffix), "_%03d", _part);
+			std::string base = _dir + _name + suffix;
+			_data = fopen((base + ".pack").c_str(), "wb");
+			_index = fopen((base + ".index").c_str(), "w");
+			_offset = 0;
+			if (!_data || !_index)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s.pack!", base.c_str());
+				ClosePart();
+				return false;
+			}
+			// large writes go straight to the file, small files are gathered
+			setvbuf(_data, nullptr, _IOFBF, 1 << 20);
+			return true;
+		}
+
+		bool PackFile::Append(const std::string& path, const std::vector<std::vector<char>>& buffers)
+		{
+			unsigned long long length = 0;
+			for (const auto& buffer : buffers)
+			{
+				length += buffer.size();
+			}
+			std::lock_guard<std::mutex> lock(_mutex);
+			if (!_data || (_offset > 0 && _offset + length > MaxPartBytes))
+			{
+				if (!OpenPart())
+				{
+					return false;
+				}
+			}
+			for (const auto& buffer : buffers)
+			{
+				if (!buffer.empty() && fwrite(buffer.data(), 1, buffer.size(), _data) != buffer.size())
+				{
+					seed::log::DumpLog(seed::log::Critical, "An error has occurred while packing file %s!", path.c_str());
+					return false;
+				}
+			}
+			fprintf(_index, "%s\t%llu\t%llu\n", path.c_str(), _offset, length);
+			_offset += length;
+			return true;
+		}
+
+		bool PackFile::Sync()
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			bool succeeded = true;
+			// the data first: an index line never refers to bytes not yet written
+			if (_data && fflush(_data) != 0)
+				succeeded = false;
+			if (_index && fflush(_index) != 0)
+				succeeded = false;
+			return succeeded;
+		}
+
+		bool PackFile::Close()
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			return ClosePart();
+		}
+
+		bool PackFile::ClosePart()
+		{
+			bool succeeded = true;
+			if (_data && fclose(_data) != 0)
+				succeeded = false;
+			if (_index && fclose(_index) != 0)
+				succeeded = false;
+			_data = nullptr;
+			_index = nullptr;
+			return succeeded;
+		}
+
+		std::string UniquePackName()
+		{
+			std::random_device random;
+			char name[32];
+			snprintf(name, sizeof(name), "%08x%08x", random(), (unsigned int)std::chrono::system_clock::now().time_since_epoch().count());
+			return name;
+		}
+
+		bool UnpackFiles(const std::string& packDir, const std::string& output)
+		{
+			std::vector<std::string> indices;
+			std::error_code ec;
+			for (fs::directory_iterator it(packDir, ec), end; !ec && it != end; it.increment(ec))
+			{
+				if (it->path().extension() == ".index")
+				{
+					indices.push_back(it->path().string());
+				}
+			}
+			if (indices.empty())
+			{
+				seed::log::DumpLog(seed::log::Critical, "No pack found in %s!", packDir.c_str());
+				return false;
+			}
+			std::sort(indices.begin(), indices.end());
+
+			size_t count = 0;
+			for (const auto& index : indices)
+			{
+				std::string pack = index.substr(0, index.size() - 6) + ".pack";
+				std::ifstream indexFile(index);
+				std::ifstream packFile(pack, std::ios::in | std::ios::binary);
+				if (!indexFile || !packFile)
+				{
+					seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", pack.c_str());
+					return false;
+				}
+				std::string line;
+				while (std::getline(indexFile, line))
+				{
+					std::stringstream lineStream(line);
+					std::string path;
+					unsigned long long offset = 0, length = 0;
+					if (!std::getline(lineStream, path, '\t') || !(lineStream >> offset >> length))
+						continue;
+
+					std::vector<std::vector<char>> buffers(1, std::vector<char>((size_t)length));
+					packFile.seekg((std::streamoff)offset);
+					if (!packFile.read(buffers[0].data(), (std::streamsize)length))
+					{
+						seed::log::DumpLog(seed::log::Critical, "File %s is truncated in %s!", path.c_str(), pack.c_str());
+						return false;
+					}
+					std::string target = output + "/" + path;
+					if (!seed::utils::CheckOrCreateFolder(fs::path(target).parent_path().string()) || !WriteWholeFile(target, buffers))
+					{
+						return false;
+					}
+					count++;
+				}
+			}
+			seed::log::DumpLog(seed::log::Info, "Unpacked %d files from %d packs", (int)count, (int)indices.size());
+			return true;
+		}
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace seed
+{
+	namespace io
+	{
+		// Many small files appended into a few large ones: <dir>/<name>_<part>.pack holds the files
+		// one after the other, <dir>/<name>_<part>.index one "path<TAB>offset<TAB>length" line per
+		// file. Paths are relative to the output folder, so a viewer or a proxy can serve a file
+		// with an HTTP range request on the pack. Every process writes its own packs.
+		class PackFile
+		{
+		public:
+			PackFile(const std::string& dir, const std::string& name) : _dir(dir), _name(name) {}
+			~PackFile() { ClosePart(); }
+
+			bool Append(const std::string& path, const std::vector<std::vector<char>>& buffers);
+
+			// flush the packed files and their index lines to the file system
+			bool Sync();
+			bool Close();
+
+		private:
+			PackFile(const PackFile&) = delete;
+			PackFile& operator=(const PackFile&) = delete;
+
+			bool OpenPart();
+			bool ClosePart();
+
+			// a new part is started beyond this size, so that no pack is too large to copy
+			static const unsigned long long MaxPartBytes = 4ull << 30;
+
+			std::mutex _mutex;
+			std::string _dir;
+			std::string _name;
+			int _part = -1;
+			FILE* _data = nullptr;
+			FILE* _index = nullptr;
+			unsigned long long _offset = 0;
+		};
+
+		// unique among the processes writing to the same folder, on any machine
+		std::string UniquePackName();
+
+		// write the files of all packs of packDir to output/<path>
+		bool UnpackFiles(const std::string& packDir, const std::string& output);
+	}
+}
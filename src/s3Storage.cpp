@@ -0,0 +1,514 @@
+#include "s3Storage.h"
+#include "common.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#pragma comment(lib, "ws2_32.lib")
+#else
+#include <netdb.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace seed
+{
+	namespace io
+	{
+		namespace
+		{
+			// FIPS 180-4 SHA-256, for the payload hashes and the HMAC keys of Signature Version 4
+			class Sha256
+			{
+			public:
+				Sha256()
+				{
+					static const uint32_t init[8] = { 0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19 };
+					memcpy(_state, init, sizeof(_state));
+				}
+
+				void Update(const void* data, size_t size)
+				{
+					const unsigned char* bytes = (const unsigned char*)data;
+					_length += size;
+					while (size > 0)
+					{
+						size_t count = std::min(size, sizeof(_block) - _used);
+						memcpy(_block + _used, bytes, count);
+						_used += count;
+						bytes += count;
+						size -= count;
+						if (_used == sizeof(_block))
+						{
+							Transform();
+							_used = 0;
+						}
+					}
+				}
+
+				std::string Final()
+				{
+					unsigned long long bits = _length * 8;
+					unsigned char pad = 0x80;
+					Update(&pad, 1);
+					pad = 0;
+					while (_used != 56)
+					{
+						Update(&pad, 1);
+					}
+					unsigned char length[8];
+					for (int i = 0; i < 8; ++i)
+					{
+						length[i] = (unsigned char)(bits >> (56 - 8 * i));
+					}
+					Update(length, 8);
+					std::string digest(32, '\0');
+					for (int i = 0; i < 32; ++i)
+					{
+						digest[i] = (char)(_state[i / 4] >> (24 - 8 * (i % 4)));
+					}
+					return digest;
+				}
+
+			private:
+				static uint32_t Rotate(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+				void Transform()
+				{
+					static const uint32_t k[64] = {
+						0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+						0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+						0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+						0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+						0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+						0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+						0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+						0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2 };
+					uint32_t w[64];
+					for (int i = 0; i < 16; ++i)
+					{
+						w[i] = ((uint32_t)_block[4 * i] << 24) | ((uint32_t)_block[4 * i + 1] << 16) | ((uint32_t)_block[4 * i + 2] << 8) | _block[4 * i + 3];
+					}
+					for (int i = 16; i < 64; ++i)
+					{
+						uint32_t s0 = Rotate(w[i - 15], 7) ^ Rotate(w[i - 15], 18) ^ (w[i - 15] >> 3);
+						uint32_t s1 = Rotate(w[i - 2], 17) ^ Rotate(w[i - 2], 19) ^ (w[i - 2] >> 10);
+						w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+					}
+					uint32_t a = _state[0], b = _state[1], c = _state[2], d = _state[3], e = _state[4], f = _state[5], g = _state[6], h = _state[7];
+					for (int i = 0; i < 64; ++i)
+					{
+						uint32_t t1 = h + (Rotate(e, 6) ^ Rotate(e, 11) ^ Rotate(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i];
+						uint32_t t2 = (Rotate(a, 2) ^ Rotate(a, 13) ^ Rotate(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+						h = g; g = f; f = e; e = d + t1; d = c; c = b; b = a; a = t1 + t2;
+					}
+					_state[0] += a; _state[1] += b; _state[2] += c; _state[3] += d;
+					_state[4] += e; _state[5] += f; _state[6] += g; _state[7] += h;
+				}
+
+				uint32_t _state[8];
+				unsigned char _block[64];
+				size_t _used = 0;
+				unsigned long long _length = 0;
+			};
+
+			std::string Hash(const void* data, size_t size)
+			{
+				Sha256 sha;
+				sha.Update(data, size);
+				return sha.Final();
+			}
+
+			std::string Hmac(const std::string& key, const std::string& message)
+			{
+				std::string block = key.size() > 64 ? Hash(key.data(), key.size()) : key;
+				block.resize(64, '\0');
+				std::string inner(64, '\0'), outer(64, '\0');
+				for (int i = 0; i < 64; ++i)
+				{
+					inner[i] = block[i] ^ 0x36;
+					outer[i] = block[i] ^ 0x5c;
+				}
+				Sha256 innerSha;
+				innerSha.Update(inner.data(), inner.size());
+				innerSha.Update(message.data(), message.size());
+				std::string innerDigest = innerSha.Final();
+				Sha256 outerSha;
+				outerSha.Update(outer.data(), outer.size());
+				outerSha.Update(innerDigest.data(), innerDigest.size());
+				return outerSha.Final();
+			}
+
+			std::string Hex(const std::string& bytes)
+			{
+				static const char digits[] = "0123456789abcdef";
+				std::string hex;
+				for (unsigned char byte : bytes)
+				{
+					hex += digits[byte >> 4];
+					hex += digits[byte & 15];
+				}
+				return hex;
+			}
+
+			// RFC 3986 unreserved characters are kept, and '/' in object keys
+			std::string UriEncode(const std::string& text, bool keepSlash)
+			{
+				static const char digits[] = "0123456789ABCDEF";
+				std::string encoded;
+				for (unsigned char c : text)
+				{
+					if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~' || (keepSlash && c == '/'))
+					{
+						encoded += (char)c;
+					}
+					else
+					{
+						encoded += '%';
+						encoded += digits[c >> 4];
+						encoded += digits[c & 15];
+					}
+				}
+				return encoded;
+			}
+
+			std::string XmlValue(const std::string& xml, const std::string& tag)
+			{
+				size_t begin = xml.find("<" + tag + ">");
+				size_t end = xml.find("</" + tag + ">");
+				if (begin == std::string::npos || end == std::string::npos || end < begin)
+				{
+					return "";
+				}
+				begin += tag.size() + 2;
+				return xml.substr(begin, end - begin);
+			}
+
+#ifdef _WIN32
+			typedef SOCKET Socket;
+			const Socket NoSocket = INVALID_SOCKET;
+			void CloseSocket(Socket s) { closesocket(s); }
+#else
+			typedef int Socket;
+			const Socket NoSocket = -1;
+			void CloseSocket(Socket s) { close(s); }
+#endif
+
+			// a stalled endpoint fails the request (and it is retried) instead of blocking a writer thread
+			void SetTimeouts(Socket s, int seconds)
+			{
+#ifdef _WIN32
+				DWORD timeout = seconds * 1000;
+#else
+				timeval timeout = { seconds, 0 };
+#endif
+				setsockopt(s, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout));
+				setsockopt(s, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+#ifdef SO_NOSIGPIPE
+				int on = 1;
+				setsockopt(s, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+			}
+
+			Socket Connect(const std::string& host, int port, int timeoutSeconds)
+			{
+#ifdef _WIN32
+				static std::once_flag started;
+				std::call_once(started, [] { WSADATA data; WSAStartup(MAKEWORD(2, 2), &data); });
+#endif
+				addrinfo hints;
+				memset(&hints, 0, sizeof(hints));
+				hints.ai_family = AF_UNSPEC;
+				hints.ai_socktype = SOCK_STREAM;
+				addrinfo* addresses = nullptr;
+				if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0)
+				{
+					return NoSocket;
+				}
+				Socket s = NoSocket;
+				for (addrinfo* address = addresses; address && s == NoSocket; address = address->ai_next)
+				{
+					s = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+					if (s != NoSocket)
+					{
+						SetTimeouts(s, timeoutSeconds);
+					}
+					if (s != NoSocket && connect(s, address->ai_addr, (int)address->ai_addrlen) != 0)
+					{
+						CloseSocket(s);
+						s = NoSocket;
+					}
+				}
+				freeaddrinfo(addresses);
+				return s;
+			}
+
+			bool SendAll(Socket s, const char* data, size_t size)
+			{
+				// a server closing the connection early (rejecting a part) must not raise SIGPIPE
+#ifdef MSG_NOSIGNAL
+				const int flags = MSG_NOSIGNAL;
+#else
+				const int flags = 0;
+#endif
+				while (size > 0)
+				{
+					int sent = send(s, data, (int)std::min<size_t>(size, 1 << 20), flags);
+					if (sent <= 0)
+					{
+						return false;
+					}
+					data += sent;
+					size -= sent;
+				}
+				return true;
+			}
+
+			std::string Dechunk(const std::string& body)
+			{
+				std::string decoded;
+				size_t pos = 0;
+				while (pos < body.size())
+				{
+					size_t endOfLine = body.find("\r\n", pos);
+					if (endOfLine == std::string::npos)
+						break;
+					size_t size = strtoul(body.c_str() + pos, nullptr, 16);
+					if (size == 0)
+						break;
+					decoded.append(body, endOfLine + 2, size);
+					pos = endOfLine + 2 + size + 2;
+				}
+				return decoded;
+			}
+		}
+
+		bool S3Storage::Open(const std::string& url)
+		{
+			std::string path = url.substr(5);
+			size_t slash = path.find('/');
+			_bucket = path.substr(0, slash);
+			_prefix = slash == std::string::npos ? "" : path.substr(slash + 1);
+			if (!_prefix.empty() && _prefix.back() != '/')
+			{
+				_prefix += '/';
+			}
+
+			const char* endpoint = getenv("AWS_ENDPOINT_URL");
+			const char* accessKey = getenv("AWS_ACCESS_KEY_ID");
+			const char* secretKey = getenv("AWS_SECRET_ACCESS_KEY");
+			const char* region = getenv("AWS_REGION");
+			if (_bucket.empty() || !endpoint || !accessKey || !secretKey)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Output %s needs a bucket, and AWS_ENDPOINT_URL, AWS_ACCESS_KEY_ID and AWS_SECRET_ACCESS_KEY!", url.c_str());
+				return false;
+			}
+			std::string server = endpoint;
+			if (server.compare(0, 7, "http://") != 0)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Endpoint %s is not supported, only http:// endpoints are!", endpoint);
+				return false;
+			}
+			server = server.substr(7, server.find('/', 7) == std::string::npos ? std::string::npos : server.find('/', 7) - 7);
+			size_t colon = server.rfind(':');
+			_host = server.substr(0, colon);
+			_port = colon == std::string::npos ? 80 : atoi(server.c_str() + colon + 1);
+			_accessKey = accessKey;
+			_secretKey = secretKey;
+			_region = region && *region ? region : "us-east-1";
+			return true;
+		}
+
+		bool S3Storage::Request(const std::string& method, const std::string& key, const std::string& query,
+			const char* body, size_t size, Response& response)
+		{
+			std::string hostHeader = _port == 80 ? _host : _host + ":" + std::to_string(_port);
+			std::string uri = "/" + UriEncode(_bucket, false) + "/" + UriEncode(key, true);
+			std::string payloadHash = Hex(Hash(body, size));
+
+			for (int attempt = 1; attempt <= Attempts; ++attempt)
+			{
+				// Signature Version 4, signed again for each attempt as it expires
+				char amzDate[17], date[9];
+				time_t now = time(nullptr);
+				tm utc;
+#ifdef _WIN32
+				gmtime_s(&utc, &now);
+#else
+				gmtime_r(&now, &utc);
+#endif
+				strftime(amzDate, sizeof(amzDate), "%Y%m%dT%H%M%SZ", &utc);
+				strftime(date, sizeof(date), "%Y%m%d", &utc);
+				std::string signedHeaders = "host;x-amz-content-sha256;x-amz-date";
+				std::string canonical = method + "\n" + uri + "\n" + query + "\n"
+					+ "host:" + hostHeader + "\n" + "x-amz-content-sha256:" + payloadHash + "\n" + "x-amz-date:" + amzDate + "\n\n"
+					+ signedHeaders + "\n" + payloadHash;
+				std::string scope = std::string(date) + "/" + _region + "/s3/aws4_request";
+				std::string stringToSign = std::string("AWS4-HMAC-SHA256\n") + amzDate + "\n" + scope + "\n" + Hex(Hash(canonical.data(), canonical.size()));
+				std::string signingKey = Hmac(Hmac(Hmac(Hmac("AWS4" + _secretKey, date), _region), "s3"), "aws4_request");
+				std::string signature = Hex(Hmac(signingKey, stringToSign));
+
+				std::string head = method + " " + uri + (query.empty() ? "" : "?" + query) + " HTTP/1.1\r\n"
+					+ "Host: " + hostHeader + "\r\n"
+					+ "x-amz-content-sha256: " + payloadHash + "\r\n"
+					+ "x-amz-date: " + amzDate + "\r\n"
+					+ "Authorization: AWS4-HMAC-SHA256 Credential=" + _accessKey + "/" + scope + ", SignedHeaders=" + signedHeaders + ", Signature=" + signature + "\r\n"
+					+ "Content-Length: " + std::to_string(size) + "\r\n"
+					+ "Connection: close\r\n\r\n";
+
+				response = Response();
+				Socket s = Connect(_host, _port, TimeoutSeconds);
+				if (s != NoSocket && SendAll(s, head.data(), head.size()) && SendAll(s, body, size))
+				{
+					std::string received;
+					char buffer[16384];
+					int count;
+					while ((count = recv(s, buffer, sizeof(buffer), 0)) > 0)
+					{
+						received.append(buffer, count);
+					}
+					if (count < 0)
+					{
+						// timed out or reset: a partial response is a connection error
+						received.clear();
+					}
+					size_t headEnd = received.find("\r\n\r\n");
+					if (headEnd != std::string::npos && received.compare(0, 5, "HTTP/") == 0)
+					{
+						response.status = atoi(received.c_str() + received.find(' ') + 1);
+						size_t line = received.find("\r\n") + 2;
+						while (line < headEnd)
+						{
+							size_t lineEnd = received.find("\r\n", line);
+							size_t colon = received.find(':', line);
+							if (colon < lineEnd)
+							{
+								std::string name = received.substr(line, colon - line);
+								std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+								size_t value = received.find_first_not_of(' ', colon + 1);
+								response.headers[name] = received.substr(value, lineEnd - value);
+							}
+							line = lineEnd + 2;
+						}
+						response.body = received.substr(headEnd + 4);
+						if (response.headers["transfer-encoding"] == "chunked")
+						{
+							response.body = Dechunk(response.body);
+						}
+					}
+				}
+				if (s != NoSocket)
+				{
+					CloseSocket(s);
+				}
+
+				if (response.status >= 200 && response.status < 300)
+				{
+					return true;
+				}
+				if (response.status != 0 && response.status < 500)
+				{
+					break;
+				}
+				std::this_thread::sleep_for(std::chrono::seconds(attempt));
+			}
+			seed::log::DumpLog(seed::log::Critical, "%s %s failed with status %d: %s", method.c_str(), uri.c_str(), response.status, XmlValue(response.body, "Message").c_str());
+			return false;
+		}
+
+		bool S3Storage::Write(const std::string& path, const std::vector<std::vector<char>>& buffers)
+		{
+			unsigned long long size = 0;
+			for (const auto& buffer : buffers)
+			{
+				size += buffer.size();
+			}
+			if (size <= PartSize)
+			{
+				return Put(_prefix + path, buffers, size);
+			}
+			return PutMultipart(_prefix + path, buffers, size);
+		}
+
+		// bytes [offset, offset + size) of the buffers laid end to end
+		static void CopyRange(const std::vector<std::vector<char>>& buffers, unsigned long long offset, size_t size, std::vector<char>& out)
+		{
+			out.clear();
+			out.reserve(size);
+			for (const auto& buffer : buffers)
+			{
+				if (out.size() == size)
+					break;
+				if (offset >= buffer.size())
+				{
+					offset -= buffer.size();
+					continue;
+				}
+				size_t count = std::min<size_t>(buffer.size() - (size_t)offset, size - out.size());
+				out.insert(out.end(), buffer.begin() + (size_t)offset, buffer.begin() + (size_t)offset + count);
+				offset = 0;
+			}
+		}
+
+		bool S3Storage::Put(const std::string& key, const std::vector<std::vector<char>>& buffers, unsigned long long size)
+		{
+			std::vector<char> body;
+			CopyRange(buffers, 0, (size_t)size, body);
+			Response response;
+			return Request("PUT", key, "", body.data(), body.size(), response);
+		}
+
+		bool S3Storage::PutMultipart(const std::string& key, const std::vector<std::vector<char>>& buffers, unsigned long long size)
+		{
+			Response response;
+			if (!Request("POST", key, "uploads=", nullptr, 0, response))
+			{
+				return false;
+			}
+			std::string uploadId = XmlValue(response.body, "UploadId");
+			if (uploadId.empty())
+			{
+				seed::log::DumpLog(seed::log::Critical, "No upload id for object %s!", key.c_str());
+				return false;
+			}
+			std::string uploadQuery = "uploadId=" + UriEncode(uploadId, false);
+
+			std::string complete = "<CompleteMultipartUpload>";
+			std::vector<char> part;
+			bool uploaded = true;
+			int partNumber = 1;
+			for (unsigned long long offset = 0; offset < size && uploaded; offset += PartSize, ++partNumber)
+			{
+				CopyRange(buffers, offset, (size_t)std::min<unsigned long long>(PartSize, size - offset), part);
+				// query parameters in the canonical (sorted) order
+				std::string query = "partNumber=" + std::to_string(partNumber) + "&" + uploadQuery;
+				uploaded = Request("PUT", key, query, part.data(), part.size(), response);
+				complete += "<Part><PartNumber>" + std::to_string(partNumber) + "</PartNumber><ETag>" + response.headers["etag"] + "</ETag></Part>";
+			}
+			complete += "</CompleteMultipartUpload>";
+
+			if (!uploaded || !Request("POST", key, uploadQuery, complete.data(), complete.size(), response))
+			{
+				// parts of an upload never completed are kept, and billed, until it is aborted
+				Request("DELETE", key, uploadQuery, nullptr, 0, response);
+				return false;
+			}
+			// a completed upload may still fail, with an error in a 200 response
+			if (response.body.find("<Error>") != std::string::npos)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Upload of object %s failed: %s", key.c_str(), XmlValue(response.body, "Message").c_str());
+				return false;
+			}
+			return true;
+		}
+	}
+}
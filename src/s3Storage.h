@@ -0,0 +1,56 @@
+#pragma once
+
+#include "storage.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace seed
+{
+	namespace io
+	{
+		// Objects of an S3 compatible store (AWS S3, MinIO, Ceph...), "s3://bucket/prefix". Files
+		// up to PartSize are sent with one PUT, larger ones with a multipart upload. The endpoint
+		// and the credentials are read from the usual variables: AWS_ENDPOINT_URL
+		// (http://host:port, path style requests), AWS_ACCESS_KEY_ID, AWS_SECRET_ACCESS_KEY and
+		// AWS_REGION (default us-east-1). Requests are signed with AWS Signature Version 4 and
+		// sent over plain HTTP: use a local endpoint or a TLS terminating proxy.
+		class S3Storage : public Storage
+		{
+		public:
+			bool Open(const std::string& url);
+
+			const char* Name() const override { return "s3"; }
+			bool Write(const std::string& path, const std::vector<std::vector<char>>& buffers) override;
+			size_t Concurrency() const override { return 8; }
+
+		private:
+			struct Response
+			{
+				int status = 0;
+				std::map<std::string, std::string> headers;	// names in lower case
+				std::string body;
+			};
+
+			// one signed request, retried on connection errors, timeouts and 5xx responses
+			bool Request(const std::string& method, const std::string& key, const std::string& query,
+				const char* body, size_t size, Response& response);
+			bool Put(const std::string& key, const std::vector<std::vector<char>>& buffers, unsigned long long size);
+			bool PutMultipart(const std::string& key, const std::vector<std::vector<char>>& buffers, unsigned long long size);
+
+			// S3 parts are at least 5 MB, except the last one
+			static const size_t PartSize = 8 << 20;
+			static const int Attempts = 3;
+			static const int TimeoutSeconds = 60;	// without progress on a connection
+
+			std::string _host;
+			int _port = 80;
+			std::string _bucket;
+			std::string _prefix;	// "" or ending with '/'
+			std::string _accessKey;
+			std::string _secretKey;
+			std::string _region;
+		};
+	}
+}
@@ -0,0 +1,265 @@
+#include "simplify.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <unordered_map>
+
+namespace seed
+{
+	namespace io
+	{
+		// symmetric 4x4 error quadric of the planes a vertex lies on
+		struct Quadric
+		{
+			double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+			double a11 = 0, a12 = 0, a13 = 0;
+			double a22 = 0, a23 = 0;
+			double a33 = 0;
+
+			void AddPlane(double nx, double ny, double nz, double d, double w)
+			{
+				a00 += w * nx * nx; a01 += w * nx * ny; a02 += w * nx * nz; a03 += w * nx * d;
+				a11 += w * ny * ny; a12 += w * ny * nz; a13 += w * ny * d;
+				a22 += w * nz * nz; a23 += w * nz * d;
+				a33 += w * d * d;
+			}
+
+			void Add(const Quadric& q)
+			{
+				a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+				a11 += q.a11; a12 += q.a12; a13 += q.a13;
+				a22 += q.a22; a23 += q.a23;
+				a33 += q.a33;
+			}
+
+			double Error(const float* p) const
+			{
+				double x = p[0], y = p[1], z = p[2];
+				return a00 * x * x + 2 * a01 * x * y + 2 * a02 * x * z + 2 * a03 * x
+					+ a11 * y * y + 2 * a12 * y * z + 2 * a13 * y
+					+ a22 * z * z + 2 * a23 * z
+					+ a33;
+			}
+		};
+
+		struct Collapse
+		{
+			double cost;
+			unsigned int from;
+			unsigned int to;
+			unsigned int fromStamp;
+			unsigned int toStamp;
+
+			bool operator<(const Collapse& other) const { return cost > other.cost; }
+		};
+
+		static void Cross(const float* a, const float* b, const float* c, double n[3])
+		{
+			double e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+			double e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+			n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+			n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+			n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+		}
+
+		void SimplifyMesh(Mesh& mesh, size_t targetTriangles)
+		{
+			const double borderWeight = 10.0;
+
+			size_t vertexCount = mesh.vertices.size() / 3;
+			size_t triangleCount = mesh.indices.size() / 3;
+			if (triangleCount <= targetTriangles || vertexCount == 0)
+			{
+				return;
+			}
+
+			std::vector<unsigned int>& indices = mesh.indices;
+			const float* positions = mesh.vertices.data();
+			std::vector<Quadric> quadrics(vertexCount);
+			std::vector<std::vector<unsigned int>> incident(vertexCount);
+			std::vector<char> triangleAlive(triangleCount, 1);
+			std::vector<char> vertexAlive(vertexCount, 1);
+			std::vector<unsigned int> stamps(vertexCount, 0);
+
+			// face planes weighted by area, counting edges to find the borders
+			std::unordered_map<unsigned long long, int> edgeCount;
+			for (size_t t = 0; t < triangleCount; ++t)
+			{
+				const unsigned int* tri = &indices[t * 3];
+				double n[3];
+				Cross(&positions[tri[0] * 3], &positions[tri[1] * 3], &positions[tri[2] * 3], n);
+				double len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+				for (int k = 0; k < 3; ++k)
+				{
+					incident[tri[k]].push_back((unsigned int)t);
+					unsigned int a = std::min(tri[k], tri[(k + 1) % 3]);
+					unsigned int b = std::max(tri[k], tri[(k + 1) % 3]);
+					edgeCount[((unsigned long long)a << 32) | b]++;
+				}
+				if (len <= 0)
+				{
+					continue;
+				}
+				double nx = n[0] / len, ny = n[1] / len, nz = n[2] / len;
+				const float* p = &positions[tri[0] * 3];
+				double d = -(nx * p[0] + ny * p[1] + nz * p[2]);
+				for (int k = 0; k < 3; ++k)
+				{
+					quadrics[tri[k]].AddPlane(nx, ny, nz, d, len * 0.5);
+				}
+			}
+
+			// planes through border edges, perpendicular to their face
+			for (size_t t = 0; t < triangleCount; ++t)
+			{
+				const unsigned int* tri = &indices[t * 3];
+				double n[3];
+				Cross(&positions[tri[0] * 3], &positions[tri[1] * 3], &positions[tri[2] * 3], n);
+				for (int k = 0; k < 3; ++k)
+				{
+					unsigned int a = tri[k], b = tri[(k + 1) % 3];
+					if (edgeCount[((unsigned long long)std::min(a, b) << 32) | std::max(a, b)] != 1)
+						continue;
+
+					const float* pa = &positions[a * 3];
+					const float* pb = &positions[b * 3];
+					double e[3] = { pb[0] - pa[0], pb[1] - pa[1], pb[2] - pa[2] };
+					double bn[3] = { e[1] * n[2] - e[2] * n[1], e[2] * n[0] - e[0] * n[2], e[0] * n[1] - e[1] * n[0] };
+					double len = std::sqrt(bn[0] * bn[0] + bn[1] * bn[1] + bn[2] * bn[2]);
+					if (len <= 0)
+						continue;
+					bn[0] /= len; bn[1] /= len; bn[2] /= len;
+					double d = -(bn[0] * pa[0] + bn[1] * pa[1] + bn[2] * pa[2]);
+					double w = borderWeight * (e[0] * e[0] + e[1] * e[1] + e[2] * e[2]);
+					quadrics[a].AddPlane(bn[0], bn[1], bn[2], d, w);
+					quadrics[b].AddPlane(bn[0], bn[1], bn[2], d, w);
+				}
+			}
+			edgeCount.clear();
+
+			std::priority_queue<Collapse> queue;
+			auto push = [&](unsigned int from, unsigned int to)
+			{
+				Quadric q = quadrics[from];
+				q.Add(quadrics[to]);
+				queue.push(Collapse{ q.Error(&positions[to * 3]), from, to, stamps[from], stamps[to] });
+			};
+			for (size_t t = 0; t < triangleCount; ++t)
+			{
+				const unsigned int* tri = &indices[t * 3];
+				for (int k = 0; k < 3; ++k)
+				{
+					push(tri[k], tri[(k + 1) % 3]);
+					push(tri[(k + 1) % 3], tri[k]);
+				}
+			}
+
+			size_t aliveCount = triangleCount;
+			while (aliveCount > targetTriangles && !queue.empty())
+			{
+				Collapse c = queue.top();
+				queue.pop();
+				if (!vertexAlive[c.from] || !vertexAlive[c.to] || stamps[c.from] != c.fromStamp || stamps[c.to] != c.toStamp)
+					continue;
+
+				// the edge must still exist and no remaining face around 'from' may flip
+				bool connected = false;
+				bool flips = false;
+				for (unsigned int t : incident[c.from])
+				{
+					if (!triangleAlive[t])
+						continue;
+					unsigned int* tri = &indices[t * 3];
+					if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+					{
+						connected = true;
+						continue;
+					}
+					const float* p[3];
+					const float* q[3];
+					for (int k = 0; k < 3; ++k)
+					{
+						p[k] = &positions[tri[k] * 3];
+						q[k] = tri[k] == c.from ? &positions[c.to * 3] : p[k];
+					}
+					double before[3], after[3];
+					Cross(p[0], p[1], p[2], before);
+					Cross(q[0], q[1], q[2], after);
+					if (before[0] * after[0] + before[1] * after[1] + before[2] * after[2] <= 0)
+					{
+						flips = true;
+						break;
+					}
+				}
+				if (!connected || flips)
+					continue;
+
+				for (unsigned int t : incident[c.from])
+				{
+					if (!triangleAlive[t])
+						continue;
+					unsigned int* tri = &indices[t * 3];
+					if (tri[0] == c.to || tri[1] == c.to || tri[2] == c.to)
+					{
+						triangleAlive[t] = 0;
+						aliveCount--;
+						continue;
+					}
+					for (int k = 0; k < 3; ++k)
+					{
+						if (tri[k] == c.from)
+							tri[k] = c.to;
+					}
+					incident[c.to].push_back(t);
+				}
+				vertexAlive[c.from] = 0;
+				incident[c.from].clear();
+				quadrics[c.to].Add(quadrics[c.from]);
+				stamps[c.to]++;
+
+				// drop dead faces and queue the edges around the surviving vertex again
+				std::vector<unsigned int>& faces = incident[c.to];
+				faces.erase(std::remove_if(faces.begin(), faces.end(), [&](unsigned int t) { return !triangleAlive[t]; }), faces.end());
+				for (unsigned int t : faces)
+				{
+					const unsigned int* tri = &indices[t * 3];
+					for (int k = 0; k < 3; ++k)
+					{
+						if (tri[k] != c.to)
+						{
+							push(c.to, tri[k]);
+							push(tri[k], c.to);
+						}
+					}
+				}
+			}
+
+			// compact the surviving triangles and vertices
+			std::vector<unsigned int> remap(vertexCount, ~0u);
+			Mesh result;
+			for (size_t t = 0; t < triangleCount; ++t)
+			{
+				if (!triangleAlive[t])
+					continue;
+				for (int k = 0; k < 3; ++k)
+				{
+					unsigned int v = indices[t * 3 + k];
+					if (remap[v] == ~0u)
+					{
+						remap[v] = (unsigned int)(result.vertices.size() / 3);
+						result.vertices.insert(result.vertices.end(), &mesh.vertices[v * 3], &mesh.vertices[v * 3] + 3);
+						if (mesh.normals.size() == vertexCount * 3)
+							result.normals.insert(result.normals.end(), &mesh.normals[v * 3], &mesh.normals[v * 3] + 3);
+						if (mesh.uvs.size() == vertexCount * 2)
+							result.uvs.insert(result.uvs.end(), &mesh.uvs[v * 2], &mesh.uvs[v * 2] + 2);
+						if (mesh.colors.size() == vertexCount * 4)
+							result.colors.insert(result.colors.end(), &mesh.colors[v * 4], &mesh.colors[v * 4] + 4);
+					}
+					result.indices.push_back(remap[v]);
+				}
+			}
+			mesh = std::move(result);
+		}
+	}
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "model.h"
+
+namespace seed
+{
+	namespace io
+	{
+		// Decimate a tri-mesh by quadric error edge collapses (Garland-Heckbert) until at most
+		// targetTriangles remain. Collapses move a vertex onto one of its neighbours, so the
+		// attributes of the surviving vertices are kept as they are. Open borders (including
+		// uv seams) are held in place by penalty planes.
+		void SimplifyMesh(Mesh& mesh, size_t targetTriangles);
+	}
+}
@@ -0,0 +1,66 @@
+#include "storage.h"
+#include "s3Storage.h"
+#include "fileWriter.h"
+#include "common.h"
+
+namespace seed
+{
+	namespace io
+	{
+		bool LocalStorage::Write(const std::string& path, const std::vector<std::vector<char>>& buffers)
+		{
+			std::string output = _root + path;
+			size_t slash = output.find_last_of("/\\");
+			if (slash != std::string::npos)
+			{
+				std::string folder = output.substr(0, slash);
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (!_folders.count(folder))
+				{
+					if (!seed::utils::CheckOrCreateFolder(folder))
+					{
+						return false;
+					}
+					_folders.insert(folder);
+				}
+			}
+			return WriteWholeFile(output, buffers);
+		}
+
+		PackStorage::PackStorage(const std::string& output) : _files(output + "/"), _pack(output + "/Pack/", UniquePackName())
+		{
+		}
+
+		bool PackStorage::Write(const std::string& path, const std::vector<std::vector<char>>& buffers)
+		{
+			if (path.find('/') == std::string::npos)
+			{
+				return _files.Write(path, buffers);
+			}
+			return _pack.Append(path, buffers);
+		}
+
+		bool IsObjectStoreUrl(const std::string& output)
+		{
+			return output.compare(0, 5, "s3://") == 0;
+		}
+
+		std::shared_ptr<Storage> CreateStorage(const std::string& output, bool pack)
+		{
+			if (IsObjectStoreUrl(output))
+			{
+				auto storage = std::make_shared<S3Storage>();
+				if (!storage->Open(output))
+				{
+					return nullptr;
+				}
+				return storage;
+			}
+			if (pack)
+			{
+				return std::make_shared<PackStorage>(output);
+			}
+			return std::make_shared<LocalStorage>(output + "/");
+		}
+	}
+}
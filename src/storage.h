@@ -0,0 +1,71 @@
+#pragma once
+
+#include "packFile.h"
+
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace seed
+{
+	namespace io
+	{
+		// Destination of the output files, by path relative to the output ("Root.3mx",
+		// "Data/Tile_000/Tile_000.3mxb"). Write may be called concurrently for different files.
+		class Storage
+		{
+		public:
+			virtual ~Storage() {}
+
+			virtual const char* Name() const = 0;
+
+			// write a whole file, errors are logged
+			virtual bool Write(const std::string& path, const std::vector<std::vector<char>>& buffers) = 0;
+
+			// make what was written so far readable by others (flush buffers, finish uploads)
+			virtual bool Sync() { return true; }
+
+			// files written at once: a few for disks, more for high latency stores
+			virtual size_t Concurrency() const { return 2; }
+		};
+
+		// files under a root folder (a prefix: "<DIR>/", or "" for absolute paths), created with
+		// their folders
+		class LocalStorage : public Storage
+		{
+		public:
+			LocalStorage(const std::string& root) : _root(root) {}
+
+			const char* Name() const override { return "local"; }
+			bool Write(const std::string& path, const std::vector<std::vector<char>>& buffers) override;
+
+		private:
+			std::string _root;
+			std::mutex _mutex;
+			std::set<std::string> _folders;	// created or found, not checked again
+		};
+
+		// <DIR>/Pack/*.pack and *.index (see PackFile), except the top level files (Root.3mx,
+		// metadata.xml) which viewers open first and stay regular files
+		class PackStorage : public Storage
+		{
+		public:
+			PackStorage(const std::string& output);
+
+			const char* Name() const override { return "pack"; }
+			bool Write(const std::string& path, const std::vector<std::vector<char>>& buffers) override;
+			bool Sync() override { return _pack.Sync(); }
+
+		private:
+			LocalStorage _files;
+			PackFile _pack;
+		};
+
+		// "s3://bucket/prefix" (see S3Storage), else a folder, packed or not
+		std::shared_ptr<Storage> CreateStorage(const std::string& output, bool pack);
+
+		bool IsObjectStoreUrl(const std::string& output);
+	}
+}
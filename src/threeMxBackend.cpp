@@ -0,0 +1,284 @@
+#include "threeMxBackend.h"
+#include "encoder.h"
+#include "common.h"
+
+#include <cstring>
+#include <sstream>
+
+namespace seed
+{
+	namespace io
+	{
+		ThreeMxBackend::ThreeMxBackend(const std::string& output, const std::shared_ptr<Storage>& storage, const EncodeOptions& options)
+			: _output(output), _options(options), _writer(storage)
+		{
+		}
+
+		bool ThreeMxBackend::Begin(const Metadata& metadata)
+		{
+			GenerateMetadata("metadata.xml");
+			ConvertMetadataTo3mx(metadata, "Data/Root.3mxb", "Root.3mx");
+			if (!_writer.Flush())
+			{
+				seed::log::DumpLog(seed::log::Critical, "Generate the metadata of %s failed!", _output.c_str());
+				return false;
+			}
+			return true;
+		}
+
+		bool ThreeMxBackend::BeginTile(const std::string& /*tileName*/)
+		{
+			// folders are created by the storage with the files
+			return true;
+		}
+
+		bool ThreeMxBackend::WriteFile(const std::string& tileName, const std::string& baseName, const std::vector<Node>& nodes,
+			const std::vector<Resource>& resourcesGeometry, const std::vector<Resource>& resourcesTexture)
+		{
+			std::vector<Node> nodes3mx = nodes;
+			for (auto& node : nodes3mx)
+			{
+				for (auto& child : node.children)
+				{
+					child += ".3mxb";
+				}
+			}
+			std::string outputTile = tileName.empty() ? "Data/" : "Data/" + tileName + "/";
+			std::string output3mxb = outputTile + baseName + ".3mxb";
+			return Generate3mxb(nodes3mx, resourcesGeometry, resourcesTexture, output3mxb);
+		}
+
+		bool ThreeMxBackend::EndTile(const std::string& tileName)
+		{
+			if (!_writer.Flush())
+			{
+				seed::log::DumpLog(seed::log::Critical, "Write tile %s failed!", tileName.c_str());
+				return false;
+			}
+			return true;
+		}
+
+		bool ThreeMxBackend::End(const std::vector<Node>& nodes, const std::vector<Resource>& resourcesGeometry, const std::vector<Resource>& resourcesTexture)
+		{
+			std::string outputDataRoot = "Data/Root.3mxb";
+			std::vector<Node> nodes3mx = nodes;
+			for (auto& node : nodes3mx)
+			{
+				for (auto& child : node.children)
+				{
+					child += ".3mxb";
+				}
+			}
+			// with the upper level files still being written
+			if (!Generate3mxb(nodes3mx, resourcesGeometry, resourcesTexture, outputDataRoot) || !_writer.Flush())
+			{
+				seed::log::DumpLog(seed::log::Critical, "Generate %s/%s failed!", _output.c_str(), outputDataRoot.c_str());
+				return false;
+			}
+			return true;
+		}
+
+		void ThreeMxBackend::GenerateMetadata(const std::string& output)
+		{
+			std::ostringstream outfile;
+			outfile << "<?xml version=\"1.0\" encoding=\"utf - 8\"?>\n";
+			outfile << "<ModelMetadata version=\"1\">\n";
+			outfile << "	<Texture>\n";
+			outfile << "		<ColorSource>Visible</ColorSource>\n";
+			outfile << "	</Texture>\n";
+			outfile << "</ModelMetadata>\n";
+			std::string text = outfile.str();
+			std::vector<std::vector<char>> buffers(1, std::vector<char>(text.begin(), text.end()));
+			_writer.Write(output, std::move(buffers));
+		}
+
+		void ThreeMxBackend::ConvertMetadataTo3mx(const Metadata& metadata, const std::string& outputDataRootRelative, const std::string& output)
+		{
+			neb::CJsonObject oJson;
+			oJson.Add("3mxVersion", 1);
+			oJson.Add("name", "Root");
+			oJson.Add("description", "Converted by ProjSEED/To3mx, copyright <a href='https://github.com/ProjSEED/To3mx' target='_blank'>ProjSEED</a>.");
+			oJson.Add("logo", "logo.png");
+
+			neb::CJsonObject oJsonSceneOption;
+			oJsonSceneOption.Add("navigationMode", "ORBIT");
+			oJson.AddEmptySubArray("sceneOptions");
+			oJson["sceneOptions"].Add(oJsonSceneOption);
+
+			neb::CJsonObject oJsonLayer;
+			oJsonLayer.Add("type", "meshPyramid");
+			oJsonLayer.Add("id", "mesh0");
+			oJsonLayer.Add("name", "Root");
+			oJsonLayer.Add("description", "Converted by ProjSEED/To3mx, copyright <a href='https://github.com/ProjSEED/To3mx' target='_blank'>ProjSEED</a>.");
+			oJsonLayer.Add("SRS", metadata.srs);
+			oJsonLayer.AddEmptySubArray("SRSOrigin");
+			oJsonLayer["SRSOrigin"].Add(metadata.srsOrigin.x());
+			oJsonLayer["SRSOrigin"].Add(metadata.srsOrigin.y());
+			oJsonLayer["SRSOrigin"].Add(metadata.srsOrigin.z());
+			oJsonLayer.Add("root", outputDataRootRelative);
+			oJson.AddEmptySubArray("layers");
+			oJson["layers"].Add(oJsonLayer);
+
+			std::string text = oJson.ToFormattedString();
+			std::vector<std::vector<char>> buffers(1, std::vector<char>(text.begin(), text.end()));
+			_writer.Write(output, std::move(buffers));
+		}
+
+		// A node is replaced by its children once its bounding box covers maxScreenDiameter pixels,
+		// so a grid step of diameter / maxScreenDiameter keeps the quantization error of its
+		// geometry within about a pixel. Leaves (never replaced) get a step relative to their edges.
+		void ThreeMxBackend::VertexPrecisions(const std::vector<Node>& nodes, std::map<std::string, CtmPrecision>& precisions)
+		{
+			for (const auto& node : nodes)
+			{
+				CtmPrecision precision;
+				float diameter = node.bb.valid() ? node.bb.radius() * 2 : 0;
+				if (node.maxScreenDiameter > 0 && node.maxScreenDiameter < 1e29 && diameter > 0)
+				{
+					precision.vertex = diameter / node.maxScreenDiameter;
+				}
+				else
+				{
+					precision.vertexRel = LeafVertexPrecisionRel;
+				}
+				for (const auto& id : node.resources)
+				{
+					// A resource shared by several nodes takes the smallest absolute step among them. The
+					// relative leaf step is not comparable to it, and is kept only when no node gives one.
+					auto found = precisions.find(id);
+					if (found == precisions.end())
+					{
+						precisions[id] = precision;
+					}
+					else if (precision.vertex > 0 && (found->second.vertex == 0 || precision.vertex < found->second.vertex))
+					{
+						found->second = precision;
+					}
+				}
+			}
+		}
+
+		bool ThreeMxBackend::Generate3mxb(const std::vector<Node>& nodes, const std::vector<Resource>& resourcesGeometry, const std::vector<Resource>& resourcesTexture, const std::string& output)
+		{
+			// the header, then the textures and the geometries, written at once
+			size_t textureCount = _options.geometryOnly ? 0 : resourcesTexture.size();
+			std::vector<std::vector<char>> buffers(1 + textureCount + resourcesGeometry.size());
+			std::vector<char>* buffersTexture = buffers.data() + 1;
+			std::vector<char>* buffersGeometry = buffersTexture + textureCount;
+			for (size_t i = 0; i < textureCount; ++i)
+			{
+				Image downsampled;
+				bool resized = DownsampleImage(resourcesTexture[i].image, _options.maxTextureSize, downsampled);
+				EncodeImageToJpeg(resized ? downsampled : resourcesTexture[i].image, buffersTexture[i], _options.jpegQuality);
+			}
+			std::map<std::string, CtmPrecision> precisions;
+			if (_options.quantize)
+			{
+				VertexPrecisions(nodes, precisions);
+			}
+			for (size_t i = 0; i < resourcesGeometry.size(); ++i)
+			{
+				const Resource& resource = resourcesGeometry[i];
+				if (resource.format == "ctm")
+				{
+					auto found = precisions.find(resource.id);
+					EncodeMeshToCtm(resource.mesh, buffersGeometry[i], !_options.geometryOnly, found == precisions.end() ? CtmPrecision() : found->second, _options.parallelPacking);
+				}
+				else if (resource.format == "xyz")
+				{
+					EncodeMeshToXyz(resource.mesh, buffersGeometry[i]);
+				}
+			}
+
+			neb::CJsonObject oJson;
+			oJson.Add("version", 1);
+
+			oJson.AddEmptySubArray("nodes");
+			for (const auto& node : nodes)
+			{
+				oJson["nodes"].Add(NodeToJson(node));
+			}
+
+			oJson.AddEmptySubArray("resources");
+			for (size_t i = 0; i < textureCount; ++i)
+			{
+				oJson["resources"].Add(ResourceToJson(resourcesTexture[i], buffersTexture[i].size()));
+			}
+			for (size_t i = 0; i < resourcesGeometry.size(); ++i)
+			{
+				oJson["resources"].Add(ResourceToJson(resourcesGeometry[i], buffersGeometry[i].size()));
+			}
+
+			std::string jsonStr = oJson.ToString();
+			uint32_t length = jsonStr.size();
+
+			std::vector<char>& header = buffers[0];
+			header.resize(9 + jsonStr.size());
+			memcpy(header.data(), "3MXBO", 5);
+			memcpy(header.data() + 5, &length, 4);
+			memcpy(header.data() + 9, jsonStr.data(), jsonStr.size());
+
+			// errors are reported by the Flush of EndTile or End
+			_writer.Write(output, std::move(buffers));
+			return true;
+		}
+
+		neb::CJsonObject ThreeMxBackend::NodeToJson(const Node& node)
+		{
+			neb::CJsonObject oJson;
+			oJson.Add("id", node.id);
+
+			oJson.AddEmptySubArray("bbMin");
+			oJson["bbMin"].Add(node.bb.xMin());
+			oJson["bbMin"].Add(node.bb.yMin());
+			oJson["bbMin"].Add(node.bb.zMin());
+
+			oJson.AddEmptySubArray("bbMax");
+			oJson["bbMax"].Add(node.bb.xMax());
+			oJson["bbMax"].Add(node.bb.yMax());
+			oJson["bbMax"].Add(node.bb.zMax());
+
+			oJson.Add("maxScreenDiameter", node.maxScreenDiameter);
+
+			oJson.AddEmptySubArray("children");
+			for (auto child : node.children)
+			{
+				oJson["children"].Add(child);
+			}
+
+			oJson.AddEmptySubArray("resources");
+			for (auto resource : node.resources)
+			{
+				oJson["resources"].Add(resource);
+			}
+			return oJson;
+		}
+
+		neb::CJsonObject ThreeMxBackend::ResourceToJson(const Resource& resource, size_t size)
+		{
+			neb::CJsonObject oJson;
+			oJson.Add("type", resource.type);
+			oJson.Add("format", resource.format);
+			oJson.Add("id", resource.id);
+			if (resource.type == "geometryBuffer")
+			{
+				if (resource.format == "ctm" && !_options.geometryOnly)
+				{
+					oJson.Add("texture", resource.texture);
+				}
+
+				oJson.AddEmptySubArray("bbMin");
+				oJson["bbMin"].Add(resource.bb.xMin());
+				oJson["bbMin"].Add(resource.bb.yMin());
+				oJson["bbMin"].Add(resource.bb.zMin());
+
+				oJson.AddEmptySubArray("bbMax");
+				oJson["bbMax"].Add(resource.bb.xMax());
+				oJson["bbMax"].Add(resource.bb.yMax());
+				oJson["bbMax"].Add(resource.bb.zMax());
+			}
+			oJson.Add("size", (uint64)size);
+			return oJson;
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "outputBackend.h"
+#include "fileWriter.h"
+#include "encoder.h"
+#include "CJsonObject.hpp"
+
+#include <map>
+
+namespace seed
+{
+	namespace io
+	{
+		// Bentley ContextCapture 3MX: Root.3mx, metadata.xml and one 3mxb per input file, written
+		// to the storage of the output (a folder, packed or not, or an object store)
+		class ThreeMxBackend : public OutputBackend
+		{
+		public:
+			ThreeMxBackend(const std::string& output, const std::shared_ptr<Storage>& storage, const EncodeOptions& options = EncodeOptions());
+
+			~ThreeMxBackend() {}
+
+			const char* Name() const override { return "3mx"; }
+
+			bool Begin(const Metadata& metadata) override;
+			bool BeginTile(const std::string& tileName) override;
+			bool WriteFile(const std::string& tileName, const std::string& baseName, const std::vector<Node>& nodes,
+				const std::vector<Resource>& resourcesGeometry, const std::vector<Resource>& resourcesTexture) override;
+			bool EndTile(const std::string& tileName) override;
+			bool End(const std::vector<Node>& nodes, const std::vector<Resource>& resourcesGeometry, const std::vector<Resource>& resourcesTexture) override;
+
+		private:
+			void GenerateMetadata(const std::string& output);
+			void ConvertMetadataTo3mx(const Metadata& metadata, const std::string& outputDataRootRelative, const std::string& output);
+			bool Generate3mxb(const std::vector<Node>& nodes, const std::vector<Resource>& resourcesGeometry, const std::vector<Resource>& resourcesTexture, const std::string& output);
+			void VertexPrecisions(const std::vector<Node>& nodes, std::map<std::string, CtmPrecision>& precisions);
+
+			neb::CJsonObject NodeToJson(const Node& node);
+			neb::CJsonObject ResourceToJson(const Resource& resource, size_t size);
+
+		private:
+			// MG2 step of leaf geometry, relative to its average edge length
+			static constexpr float LeafVertexPrecisionRel = 0.01f;
+
+			std::string _output;	// for messages, paths are relative to the storage
+			EncodeOptions _options;
+			FileWriter _writer;
+		};
+	}
+}
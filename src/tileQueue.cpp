@@ -0,0 +1,162 @@
+#include "tileQueue.h"
+#include "common.h"
+
+#include <algorithm>
+#include <experimental/filesystem>
+#include <fstream>
+
+namespace fs = std::experimental::filesystem;
+
+namespace seed
+{
+	namespace io
+	{
+		static std::vector<std::string> ListFiles(const std::string& dir, const std::string& extension = "")
+		{
+			std::vector<std::string> names;
+			std::error_code ec;
+			for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec))
+			{
+				std::string name = it->path().filename().string();
+				if (extension.empty() || (name.size() > extension.size() && name.compare(name.size() - extension.size(), extension.size(), extension) == 0))
+				{
+					names.push_back(name);
+				}
+			}
+			std::sort(names.begin(), names.end());
+			return names;
+		}
+
+		bool WriteTileRecord(const std::string& dir, const TileRecord& record)
+		{
+			std::string output = dir + record.name + ".tile";
+			std::string temporary = output + ".tmp";
+			{
+				std::ofstream outfile(temporary);
+				if (!outfile)
+				{
+					seed::log::DumpLog(seed::log::Critical, "Can NOT open file %s!", temporary.c_str());
+					return false;
+				}
+				outfile.precision(9);
+				outfile << record.bb.xMin() << ' ' << record.bb.yMin() << ' ' << record.bb.zMin() << ' '
+					<< record.bb.xMax() << ' ' << record.bb.yMax() << ' ' << record.bb.zMax() << '\n';
+				// relative to the record folder
+				outfile << record.proxyPath.substr(record.proxyPath.find_last_of("/\\") + 1) << '\n';
+				if (!outfile)
+				{
+					seed::log::DumpLog(seed::log::Critical, "An error has occurred while writing file %s!", temporary.c_str());
+					return false;
+				}
+			}
+			std::error_code ec;
+			fs::rename(temporary, output, ec);
+			if (ec)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT rename %s to %s!", temporary.c_str(), output.c_str());
+				return false;
+			}
+			return true;
+		}
+
+		bool ReadTileRecords(const std::string& dir, std::vector<TileRecord>& records)
+		{
+			for (const auto& file : ListFiles(dir, ".tile"))
+			{
+				std::ifstream infile(dir + file);
+				TileRecord record;
+				record.name = file.substr(0, file.size() - 5);
+				float bb[6];
+				if (!(infile >> bb[0] >> bb[1] >> bb[2] >> bb[3] >> bb[4] >> bb[5]))
+				{
+					seed::log::DumpLog(seed::log::Critical, "Invalid tile record %s%s!", dir.c_str(), file.c_str());
+					return false;
+				}
+				record.bb = osg::BoundingBox(bb[0], bb[1], bb[2], bb[3], bb[4], bb[5]);
+				infile >> std::ws;
+				std::getline(infile, record.proxyPath);
+				if (!record.proxyPath.empty())
+				{
+					record.proxyPath = dir + record.proxyPath;
+				}
+				records.push_back(record);
+			}
+			return true;
+		}
+
+		bool TileQueue::Create(const std::vector<std::string>& tiles)
+		{
+			for (const char* sub : { "/todo/", "/claimed/", "/done/", "/failed/" })
+			{
+				if (!seed::utils::CheckOrCreateFolder(_dir + sub))
+				{
+					return false;
+				}
+			}
+			if (!ListFiles(_dir + "/todo/").empty() || !ListFiles(_dir + "/claimed/").empty() || !ListFiles(_dir + "/done/", ".tile").empty())
+			{
+				seed::log::DumpLog(seed::log::Warning, "Queue %s already exists, it is kept as it is.", _dir.c_str());
+				return true;
+			}
+			for (const auto& tile : tiles)
+			{
+				std::ofstream outfile(_dir + "/todo/" + tile);
+				if (!outfile)
+				{
+					seed::log::DumpLog(seed::log::Critical, "Can NOT create %s/todo/%s!", _dir.c_str(), tile.c_str());
+					return false;
+				}
+			}
+			return true;
+		}
+
+		std::string TileQueue::ClaimPath(const std::string& worker, const std::string& tile) const
+		{
+			return _dir + "/claimed/" + tile + "@" + worker;
+		}
+
+		bool TileQueue::Claim(const std::string& worker, std::string& tile)
+		{
+			// start from a worker dependent position so that workers seldom race for the same file
+			std::vector<std::string> todo = ListFiles(_dir + "/todo/");
+			size_t start = todo.empty() ? 0 : std::hash<std::string>()(worker) % todo.size();
+			for (size_t k = 0; k < todo.size(); ++k)
+			{
+				const std::string& name = todo[(start + k) % todo.size()];
+				std::error_code ec;
+				fs::rename(_dir + "/todo/" + name, ClaimPath(worker, name), ec);
+				if (!ec)
+				{
+					tile = name;
+					return true;
+				}
+			}
+			return false;
+		}
+
+		bool TileQueue::Complete(const std::string& worker, const TileRecord& record)
+		{
+			if (!WriteTileRecord(DoneDir(), record))
+			{
+				return false;
+			}
+			std::error_code ec;
+			fs::remove(ClaimPath(worker, record.name), ec);
+			return true;
+		}
+
+		bool TileQueue::Fail(const std::string& worker, const std::string& tile)
+		{
+			std::error_code ec;
+			fs::rename(ClaimPath(worker, tile), _dir + "/failed/" + tile, ec);
+			return !ec;
+		}
+
+		void TileQueue::Count(size_t& todo, size_t& claimed, size_t& failed) const
+		{
+			todo = ListFiles(_dir + "/todo/").size();
+			claimed = ListFiles(_dir + "/claimed/").size();
+			failed = ListFiles(_dir + "/failed/").size();
+		}
+	}
+}
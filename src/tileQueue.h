@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <osg/BoundingBox>
+
+namespace seed
+{
+	namespace io
+	{
+		// what the root levels need from a converted tile
+		struct TileRecord
+		{
+			std::string name;
+			osg::BoundingBox bb;
+			std::string proxyPath;	// coarse LOD proxy saved in the record folder, or empty
+		};
+
+		// <dir>/<name>.tile: the tile bounding box, written to a temporary file and renamed so
+		// that readers never see a partial record
+		bool WriteTileRecord(const std::string& dir, const TileRecord& record);
+		bool ReadTileRecords(const std::string& dir, std::vector<TileRecord>& records);
+
+		// Work queue of tiles on a shared file system, with no server and no locks: one empty file
+		// per tile in todo/, claimed by renaming it into claimed/ (a rename succeeds for one
+		// process only), and recorded in done/ once converted. Tiles that failed are moved to
+		// failed/. Claims of a crashed worker stay in claimed/, move them back to todo/ to retry.
+		class TileQueue
+		{
+		public:
+			TileQueue(const std::string& dir) : _dir(dir) {}
+
+			~TileQueue() {}
+
+			// create the queue with every tile to do, an existing queue is left as it is
+			bool Create(const std::vector<std::string>& tiles);
+
+			// claim the next tile to do, false once there is none left
+			bool Claim(const std::string& worker, std::string& tile);
+			bool Complete(const std::string& worker, const TileRecord& record);
+			bool Fail(const std::string& worker, const std::string& tile);
+
+			// tiles still to do, being converted and failed
+			void Count(size_t& todo, size_t& claimed, size_t& failed) const;
+
+			std::string DoneDir() const { return _dir + "/done/"; }
+
+		private:
+			std::string ClaimPath(const std::string& worker, const std::string& tile) const;
+
+			std::string _dir;
+		};
+	}
+}
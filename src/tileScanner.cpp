@@ -0,0 +1,107 @@
+#include "tileScanner.h"
+#include "inputArchive.h"
+#include "common.h"
+
+#include <algorithm>
+#include <cctype>
+#include <experimental/filesystem>
+
+namespace fs = std::experimental::filesystem;
+
+namespace seed
+{
+	namespace io
+	{
+		bool IsOsgbFile(const std::string& name)
+		{
+			static const char extension[] = ".osgb";
+			const size_t length = sizeof(extension) - 1;
+			if (name.size() <= length)
+				return false;
+			for (size_t i = 0; i < length; ++i)
+			{
+				if (tolower((unsigned char)name[name.size() - length + i]) != extension[i])
+					return false;
+			}
+			return true;
+		}
+
+		bool ScanTile(const std::string& inputData, const std::string& tileName, TileFiles& files)
+		{
+			std::string inputTile = inputData + tileName + "/";
+			files = TileFiles();
+			files.name = tileName;
+			files.baseNames.push_back(tileName);
+
+			std::error_code ec;
+			fs::directory_iterator it(inputTile, ec), end;
+			if (ec)
+			{
+				seed::log::DumpLog(seed::log::Critical, "Can NOT list folder %s!", inputTile.c_str());
+				return false;
+			}
+			for (; !ec && it != end; it.increment(ec))
+			{
+				std::string file = it->path().filename().string();
+				if (!IsOsgbFile(file))
+					continue;
+
+				std::string baseName = file.substr(0, file.size() - 5);
+				if (baseName == tileName)
+					continue;
+
+				files.baseNames.push_back(baseName);
+			}
+			// the order of a listing differs between file systems
+			std::sort(files.baseNames.begin() + 1, files.baseNames.end());
+
+			files.bytes.resize(files.baseNames.size());
+			for (size_t i = 0; i < files.baseNames.size(); ++i)
+			{
+				files.bytes[i] = seed::utils::FileSize(inputTile + files.baseNames[i] + ".osgb");
+			}
+			return true;
+		}
+
+		TileScanner::TileScanner(const std::string& inputData, const std::vector<std::string>& tiles, const InputArchive* archive, size_t threads)
+			: _inputData(inputData), _archive(archive), _tiles(tiles), _files(tiles.size()), _state(tiles.size(), 0), _next(0), _stop(false)
+		{
+			threads = std::min(archive ? 1 : threads, tiles.size());
+			for (size_t i = 0; i < threads; ++i)
+			{
+				_threads.emplace_back(&TileScanner::Run, this);
+			}
+		}
+
+		TileScanner::~TileScanner()
+		{
+			_stop = true;
+			for (auto& thread : _threads)
+			{
+				thread.join();
+			}
+		}
+
+		// claims tiles in order, so that the next tiles to convert are always listed first
+		void TileScanner::Run()
+		{
+			for (size_t i = _next++; i < _tiles.size() && !_stop; i = _next++)
+			{
+				TileFiles files;
+				bool listed = _archive ? _archive->ScanTile(_tiles[i], files) : ScanTile(_inputData, _tiles[i], files);
+				std::lock_guard<std::mutex> lock(_mutex);
+				_files[i] = std::move(files);
+				_state[i] = listed ? 1 : 2;
+				_listed.notify_all();
+			}
+		}
+
+		bool TileScanner::Wait(size_t index, TileFiles& files)
+		{
+			std::unique_lock<std::mutex> lock(_mutex);
+			_listed.wait(lock, [this, index] { return _state[index] != 0; });
+			files = std::move(_files[index]);
+			return _state[index] == 1;
+		}
+	}
+}
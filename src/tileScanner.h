@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace seed
+{
+	namespace io
+	{
+		class InputArchive;
+
+		// the .osgb files of a tile folder, the top level file first
+		struct TileFiles
+		{
+			std::string name;
+			std::vector<std::string> baseNames;
+			std::vector<unsigned long long> bytes;
+		};
+
+		bool ScanTile(const std::string& inputData, const std::string& tileName, TileFiles& files);
+
+		// .osgb in any case
+		bool IsOsgbFile(const std::string& name);
+
+		// Lists the tile folders on a few threads ahead of the conversion, in the order of the
+		// tiles, so that the first tile is converted while the next ones are still being listed
+		// and the listing latency of network file systems overlaps the work.
+		class TileScanner
+		{
+		public:
+			// tiles of an archive are listed from its index, without threads
+			TileScanner(const std::string& inputData, const std::vector<std::string>& tiles, const InputArchive* archive = nullptr, size_t threads = 4);
+			~TileScanner();
+
+			// blocks until the index-th tile is listed, false if its folder can not be read
+			bool Wait(size_t index, TileFiles& files);
+
+		private:
+			void Run();
+
+			std::string _inputData;
+			const InputArchive* _archive;
+			std::vector<std::string> _tiles;
+			std::vector<TileFiles> _files;
+			std::vector<char> _state;	// 0: pending, 1: listed, 2: failed
+			std::atomic<size_t> _next;
+			std::atomic<bool> _stop;
+			std::mutex _mutex;
+			std::condition_variable _listed;
+			std::vector<std::thread> _threads;
+		};
+	}
+}
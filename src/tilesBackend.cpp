@@ -0,0 +1,646 @@
+#include "tilesBackend.h"
+#include "encoder.h"
+#include "common.h"
+
+#include <map>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include <osg/Math>
+
+namespace seed
+{
+	namespace io
+	{
+		// glTF 2.0 binary (glb) assembled from the resources of one node
+		class GlbWriter
+		{
+		public:
+			GlbWriter(const EncodeOptions& options) : _options(options)
+			{
+				_json.AddEmptySubObject("asset");
+				_json["asset"].Add("version", "2.0");
+				_json["asset"].Add("generator", "To3mx");
+				_json.Add("scene", 0);
+				_json.AddEmptySubArray("scenes");
+				_json.AddEmptySubArray("nodes");
+				_json.AddEmptySubArray("meshes");
+				_json.AddEmptySubArray("materials");
+				_json.AddEmptySubArray("textures");
+				_json.AddEmptySubArray("images");
+				_json.AddEmptySubArray("accessors");
+				_json.AddEmptySubArray("bufferViews");
+				_json.AddEmptySubArray("buffers");
+				_json.AddEmptySubArray("extensionsUsed");
+				_json["extensionsUsed"].Add("KHR_materials_unlit");
+			}
+
+			// material for a texture resource, -1 for the untextured default
+			int AddMaterial(const Resource* texture)
+			{
+				auto found = _materials.find(texture);
+				if (found != _materials.end())
+				{
+					return found->second;
+				}
+
+				neb::CJsonObject oMaterial;
+				oMaterial.AddEmptySubObject("pbrMetallicRoughness");
+				oMaterial["pbrMetallicRoughness"].Add("metallicFactor", 0.0);
+				oMaterial["pbrMetallicRoughness"].Add("roughnessFactor", 1.0);
+				if (texture)
+				{
+					std::vector<char> jpeg;
+					Image downsampled;
+					bool resized = DownsampleImage(texture->image, _options.maxTextureSize, downsampled);
+					EncodeImageToJpeg(resized ? downsampled : texture->image, jpeg, _options.jpegQuality);
+
+					neb::CJsonObject oImage;
+					oImage.Add("bufferView", AddBufferView(jpeg.data(), jpeg.size(), 0));
+					oImage.Add("mimeType", "image/jpeg");
+					_json["images"].Add(oImage);
+
+					neb::CJsonObject oTexture;
+					oTexture.Add("source", _imageCount);
+					_json["textures"].Add(oTexture);
+
+					oMaterial["pbrMetallicRoughness"].AddEmptySubObject("baseColorTexture");
+					oMaterial["pbrMetallicRoughness"]["baseColorTexture"].Add("index", _imageCount);
+					_imageCount++;
+				}
+				oMaterial.AddEmptySubObject("extensions");
+				oMaterial["extensions"].AddEmptySubObject("KHR_materials_unlit");
+				_json["materials"].Add(oMaterial);
+
+				_materials[texture] = _materialCount;
+				return _materialCount++;
+			}
+
+			// glTF is y-up: (x, y, z) -> (x, z, -y), and its uv origin is the top left corner
+			void AddMesh(const Mesh& mesh, const Resource* texture, bool points)
+			{
+				size_t vertexCount = mesh.vertices.size() / 3;
+				if (vertexCount == 0 || (!points && mesh.indices.size() < 3))
+				{
+					return;
+				}
+
+				neb::CJsonObject oPrimitive;
+				oPrimitive.AddEmptySubObject("attributes");
+				{
+					std::vector<float> positions(vertexCount * 3);
+					float bbMin[3] = { 1e30f, 1e30f, 1e30f };
+					float bbMax[3] = { -1e30f, -1e30f, -1e30f };
+					for (size_t i = 0; i < vertexCount; ++i)
+					{
+						positions[i * 3 + 0] = mesh.vertices[i * 3 + 0];
+						positions[i * 3 + 1] = mesh.vertices[i * 3 + 2];
+						positions[i * 3 + 2] = -mesh.vertices[i * 3 + 1];
+						for (int k = 0; k < 3; ++k)
+						{
+							bbMin[k] = std::min(bbMin[k], positions[i * 3 + k]);
+							bbMax[k] = std::max(bbMax[k], positions[i * 3 + k]);
+						}
+					}
+					int view = AddBufferView(positions.data(), positions.size() * sizeof(float), 34962);
+					oPrimitive["attributes"].Add("POSITION", AddAccessor(view, 5126, vertexCount, "VEC3", bbMin, bbMax));
+				}
+				if (mesh.normals.size() == vertexCount * 3)
+				{
+					std::vector<float> normals(vertexCount * 3);
+					for (size_t i = 0; i < vertexCount; ++i)
+					{
+						normals[i * 3 + 0] = mesh.normals[i * 3 + 0];
+						normals[i * 3 + 1] = mesh.normals[i * 3 + 2];
+						normals[i * 3 + 2] = -mesh.normals[i * 3 + 1];
+					}
+					int view = AddBufferView(normals.data(), normals.size() * sizeof(float), 34962);
+					oPrimitive["attributes"].Add("NORMAL", AddAccessor(view, 5126, vertexCount, "VEC3"));
+				}
+				if (texture && !_options.geometryOnly && mesh.uvs.size() == vertexCount * 2)
+				{
+					std::vector<float> uvs(vertexCount * 2);
+					for (size_t i = 0; i < vertexCount; ++i)
+					{
+						uvs[i * 2 + 0] = mesh.uvs[i * 2 + 0];
+						uvs[i * 2 + 1] = 1.0f - mesh.uvs[i * 2 + 1];
+					}
+					int view = AddBufferView(uvs.data(), uvs.size() * sizeof(float), 34962);
+					oPrimitive["attributes"].Add("TEXCOORD_0", AddAccessor(view, 5126, vertexCount, "VEC2"));
+				}
+				else
+				{
+					texture = nullptr;
+				}
+				if (mesh.colors.size() == vertexCount * 4)
+				{
+					int view = AddBufferView(mesh.colors.data(), mesh.colors.size(), 34962);
+					oPrimitive["attributes"].Add("COLOR_0", AddAccessor(view, 5121, vertexCount, "VEC4", nullptr, nullptr, true));
+				}
+				if (!points)
+				{
+					int view = AddBufferView(mesh.indices.data(), mesh.indices.size() * sizeof(unsigned int), 34963);
+					oPrimitive.Add("indices", AddAccessor(view, 5125, mesh.indices.size(), "SCALAR"));
+				}
+				oPrimitive.Add("mode", points ? 0 : 4);
+				oPrimitive.Add("material", AddMaterial(texture));
+
+				neb::CJsonObject oMesh;
+				oMesh.AddEmptySubArray("primitives");
+				oMesh["primitives"].Add(oPrimitive);
+				_json["meshes"].Add(oMesh);
+
+				neb::CJsonObject oNode;
+				oNode.Add("mesh", _meshCount);
+				if (!(mesh.origin == osg::Vec3d(0, 0, 0)))
+				{
+					// positions stay relative to the local origin, in double precision here
+					oNode.AddEmptySubArray("translation");
+					oNode["translation"].Add(mesh.origin.x());
+					oNode["translation"].Add(mesh.origin.z());
+					oNode["translation"].Add(-mesh.origin.y());
+				}
+				_json["nodes"].Add(oNode);
+				_meshCount++;
+			}
+
+			bool Empty() const { return _meshCount == 0; }
+
+			void Finish(std::vector<char>& glb, size_t glbOffset)
+			{
+				if (_meshCount > 0)
+				{
+					neb::CJsonObject oScene;
+					oScene.AddEmptySubArray("nodes");
+					for (int i = 0; i < _meshCount; ++i)
+					{
+						oScene["nodes"].Add(i);
+					}
+					_json["scenes"].Add(oScene);
+				}
+
+				// pad the json chunk so the glb ends on an 8 byte boundary of the enclosing file
+				size_t binSize = (_bin.size() + 3) & ~size_t(3);
+				std::string jsonStr = JsonWithBuffer(binSize);
+				if ((glbOffset + 12 + 8 + jsonStr.size() + (binSize ? 8 + binSize : 0)) % 8)
+				{
+					jsonStr.append(4, ' ');
+				}
+				_bin.resize(binSize, 0);
+
+				size_t binChunkSize = _bin.empty() ? 0 : 8 + _bin.size();
+				uint32_t header[3] = { 0x46546C67, 2, (uint32_t)(12 + 8 + jsonStr.size() + binChunkSize) };
+				uint32_t jsonChunk[2] = { (uint32_t)jsonStr.size(), 0x4E4F534A };
+				uint32_t binChunk[2] = { (uint32_t)_bin.size(), 0x004E4942 };
+				glb.insert(glb.end(), (char*)header, (char*)header + sizeof(header));
+				glb.insert(glb.end(), (char*)jsonChunk, (char*)jsonChunk + sizeof(jsonChunk));
+				glb.insert(glb.end(), jsonStr.begin(), jsonStr.end());
+				if (!_bin.empty())
+				{
+					glb.insert(glb.end(), (char*)binChunk, (char*)binChunk + sizeof(binChunk));
+					glb.insert(glb.end(), _bin.begin(), _bin.end());
+				}
+			}
+
+		private:
+			std::string JsonWithBuffer(size_t binSize)
+			{
+				neb::CJsonObject oJson = _json;
+				if (binSize > 0)
+				{
+					neb::CJsonObject oBuffer;
+					oBuffer.Add("byteLength", (uint64)binSize);
+					oJson["buffers"].Add(oBuffer);
+				}
+
+				// glTF arrays have at least one item: the unused ones are left out
+				static const char* arrays[] = { "scenes", "nodes", "meshes", "materials", "textures", "images", "accessors", "bufferViews", "buffers" };
+				for (const char* name : arrays)
+				{
+					if (oJson[name].GetArraySize() == 0)
+					{
+						oJson.Delete(name);
+					}
+				}
+				if (_meshCount == 0)
+				{
+					oJson.Delete("scene");
+				}
+				if (_materialCount == 0)
+				{
+					oJson.Delete("extensionsUsed");
+				}
+				std::string jsonStr = oJson.ToString();
+				jsonStr.resize((jsonStr.size() + 3) & ~size_t(3), ' ');
+				return jsonStr;
+			}
+
+			int AddBufferView(const void* data, size_t size, int target)
+			{
+				_bin.resize((_bin.size() + 3) & ~size_t(3), 0);
+				neb::CJsonObject oView;
+				oView.Add("buffer", 0);
+				oView.Add("byteOffset", (uint64)_bin.size());
+				oView.Add("byteLength", (uint64)size);
+				if (target)
+				{
+					oView.Add("target", target);
+				}
+				_json["bufferViews"].Add(oView);
+				_bin.insert(_bin.end(), (const char*)data, (const char*)data + size);
+				return _viewCount++;
+			}
+
+			int AddAccessor(int view, int componentType, size_t count, const char* type,
+				const float* min = nullptr, const float* max = nullptr, bool normalized = false)
+			{
+				neb::CJsonObject oAccessor;
+				oAccessor.Add("bufferView", view);
+				oAccessor.Add("componentType", componentType);
+				oAccessor.Add("count", (uint64)count);
+				oAccessor.Add("type", type);
+				if (normalized)
+				{
+					oAccessor.Add("normalized", true, true);
+				}
+				if (min && max)
+				{
+					oAccessor.AddEmptySubArray("min");
+					oAccessor.AddEmptySubArray("max");
+					for (int k = 0; k < 3; ++k)
+					{
+						oAccessor["min"].Add(min[k]);
+						oAccessor["max"].Add(max[k]);
+					}
+				}
+				_json["accessors"].Add(oAccessor);
+				return _accessorCount++;
+			}
+
+		private:
+			EncodeOptions _options;
+			neb::CJsonObject _json;
+			std::vector<char> _bin;
+			std::map<const Resource*, int> _materials;
+			int _meshCount = 0;
+			int _materialCount = 0;
+			int _imageCount = 0;
+			int _viewCount = 0;
+			int _accessorCount = 0;
+		};
+
+		TilesBackend::TilesBackend(const std::string& output, const std::shared_ptr<Storage>& storage, const EncodeOptions& options)
+			: _output(output), _options(options), _writer(storage)
+		{
+		}
+
+		bool TilesBackend::Begin(const Metadata& metadata)
+		{
+			_metadata = metadata;
+			return true;
+		}
+
+		bool TilesBackend::BeginTile(const std::string& /*tileName*/)
+		{
+			// left by a tile that failed, folders are created by the storage with the files
+			_pendingFiles.clear();
+			_fileBounds.clear();
+			return true;
+		}
+
+		bool TilesBackend::WriteFile(const std::string& tileName, const std::string& baseName, const std::vector<Node>& nodes,
+			const std::vector<Resource>& resourcesGeometry, const std::vector<Resource>& resourcesTexture)
+		{
+			std::string outputTile = tileName.empty() ? "Data/" : "Data/" + tileName + "/";
+			if (nodes.empty())
+			{
+				return false;
+			}
+
+			PendingFile file;
+			file.output = outputTile + baseName + ".json";
+			FileBounds bounds;
+			for (size_t i = 0; i < nodes.size(); ++i)
+			{
+				const Node& node = nodes[i];
+				std::string content;
+				if (!node.resources.empty())
+				{
+					// the nodes of the upper levels are named after their file (Root_<key>) or tile, the
+					// nodes of a tile file only within it
+					if (tileName.empty())
+						content = node.id + ".b3dm";
+					else if (nodes.size() == 1)
+						content = baseName + ".b3dm";
+					else
+						content = baseName + "_" + node.id + ".b3dm";
+					if (!GenerateB3dm(node, resourcesGeometry, resourcesTexture, outputTile + content))
+					{
+						seed::log::DumpLog(seed::log::Critical, "Generate %s/%s failed!", _output.c_str(), (outputTile + content).c_str());
+						return false;
+					}
+				}
+				file.nodes.push_back(node);
+				file.nodes.back().resources.clear();
+				file.contents.push_back(content);
+				bounds.bb.expandBy(node.bb);
+				bounds.geometricError = std::max(bounds.geometricError, GeometricError(node));
+			}
+
+			// the upper levels link their files with the bounds of the nodes, which cover them exactly
+			if (tileName.empty())
+			{
+				return GenerateFileTileset(file.nodes, file.contents, file.output);
+			}
+			std::lock_guard<std::mutex> lock(_pendingMutex);
+			_fileBounds[baseName] = bounds;
+			_pendingFiles[baseName] = std::move(file);
+			return true;
+		}
+
+		bool TilesBackend::GenerateFileTileset(const std::vector<Node>& nodes, const std::vector<std::string>& contents, const std::string& output)
+		{
+			std::vector<neb::CJsonObject> tiles;
+			osg::BoundingBox bb;
+			double geometricError = 0;
+			for (size_t i = 0; i < nodes.size(); ++i)
+			{
+				tiles.push_back(NodeToTile(nodes[i], contents[i], ""));
+				bb.expandBy(nodes[i].bb);
+				geometricError = std::max(geometricError, GeometricError(nodes[i]));
+			}
+
+			neb::CJsonObject oRoot;
+			if (tiles.size() == 1)
+			{
+				oRoot = tiles[0];
+			}
+			else
+			{
+				oRoot.Add("boundingVolume", BoundingVolumeToJson(bb));
+				oRoot.Add("geometricError", geometricError);
+				oRoot.Add("refine", "REPLACE");
+				oRoot.AddEmptySubArray("children");
+				for (const auto& tile : tiles)
+				{
+					oRoot["children"].Add(tile);
+				}
+			}
+			return GenerateTileset(oRoot, geometricError, output);
+		}
+
+		bool TilesBackend::EndTile(const std::string& tileName)
+		{
+			bool generated = true;
+			for (const auto& file : _pendingFiles)
+			{
+				if (!GenerateFileTileset(file.second.nodes, file.second.contents, file.second.output))
+				{
+					seed::log::DumpLog(seed::log::Critical, "Generate %s/%s failed!", _output.c_str(), file.second.output.c_str());
+					generated = false;
+				}
+			}
+			_pendingFiles.clear();
+			_fileBounds.clear();
+			if (!generated || !_writer.Flush())
+			{
+				seed::log::DumpLog(seed::log::Critical, "Write tile %s failed!", tileName.c_str());
+				return false;
+			}
+			return true;
+		}
+
+		bool TilesBackend::End(const std::vector<Node>& nodes, const std::vector<Resource>& resourcesGeometry, const std::vector<Resource>& resourcesTexture)
+		{
+			std::string outputTileset = "tileset.json";
+
+			osg::BoundingBox bb;
+			double geometricError = 0;
+			neb::CJsonObject oRoot;
+			oRoot.AddEmptySubArray("children");
+			for (const auto& node : nodes)
+			{
+				std::string content;
+				if (!node.resources.empty())
+				{
+					content = "Data/" + node.id + ".b3dm";
+					if (!GenerateB3dm(node, resourcesGeometry, resourcesTexture, content))
+					{
+						seed::log::DumpLog(seed::log::Critical, "Generate %s/%s failed!", _output.c_str(), content.c_str());
+						return false;
+					}
+				}
+				oRoot["children"].Add(NodeToTile(node, content, "Data/"));
+				bb.expandBy(node.bb);
+				geometricError = std::max(geometricError, GeometricError(node));
+			}
+			oRoot.Add("boundingVolume", BoundingVolumeToJson(bb));
+			oRoot.Add("geometricError", geometricError);
+			oRoot.Add("refine", "REPLACE");
+
+			double transform[16];
+			if (RootTransform(transform))
+			{
+				oRoot.AddEmptySubArray("transform");
+				for (int i = 0; i < 16; ++i)
+				{
+					oRoot["transform"].Add(transform[i]);
+				}
+			}
+
+			if (!GenerateTileset(oRoot, geometricError, outputTileset) || !_writer.Flush())
+			{
+				seed::log::DumpLog(seed::log::Critical, "Generate %s/%s failed!", _output.c_str(), outputTileset.c_str());
+				return false;
+			}
+			return true;
+		}
+
+		bool TilesBackend::GenerateB3dm(const Node& node, const std::vector<Resource>& resourcesGeometry, const std::vector<Resource>& resourcesTexture, const std::string& output)
+		{
+			std::map<std::string, const Resource*> geometryMap;
+			std::map<std::string, const Resource*> textureMap;
+			for (const auto& resource : resourcesGeometry)
+			{
+				geometryMap[resource.id] = &resource;
+			}
+			for (const auto& resource : resourcesTexture)
+			{
+				textureMap[resource.id] = &resource;
+			}
+
+			GlbWriter glbWriter(_options);
+			for (const auto& id : node.resources)
+			{
+				auto found = geometryMap.find(id);
+				if (found == geometryMap.end())
+				{
+					continue;
+				}
+				const Resource* geometry = found->second;
+				const Resource* texture = nullptr;
+				if (!geometry->texture.empty() && textureMap.count(geometry->texture))
+				{
+					texture = textureMap[geometry->texture];
+				}
+				glbWriter.AddMesh(geometry->mesh, texture, geometry->format == "xyz");
+			}
+
+			// header, then a feature table without features padded to 8 bytes
+			std::string featureTable = "{\"BATCH_LENGTH\":0}";
+			featureTable.resize(((28 + featureTable.size() + 7) & ~size_t(7)) - 28, ' ');
+
+			std::vector<char> b3dm(28);
+			b3dm.insert(b3dm.end(), featureTable.begin(), featureTable.end());
+			glbWriter.Finish(b3dm, b3dm.size());
+
+			uint32_t header[7] = { 0, 1, (uint32_t)b3dm.size(), (uint32_t)featureTable.size(), 0, 0, 0 };
+			memcpy(header, "b3dm", 4);
+			memcpy(b3dm.data(), header, sizeof(header));
+
+			// errors are reported by the Flush of EndTile or End
+			std::vector<std::vector<char>> buffers(1);
+			buffers[0] = std::move(b3dm);
+			_writer.Write(output, std::move(buffers));
+			return true;
+		}
+
+		bool TilesBackend::GenerateTileset(neb::CJsonObject& root, double geometricError, const std::string& output)
+		{
+			neb::CJsonObject oJson;
+			oJson.AddEmptySubObject("asset");
+			oJson["asset"].Add("version", "1.0");
+			oJson.Add("geometricError", geometricError);
+			oJson.Add("root", root);
+
+			// errors are reported by the Flush of EndTile or End
+			std::string json = oJson.ToString();
+			std::vector<std::vector<char>> buffers(1);
+			buffers[0].assign(json.begin(), json.end());
+			_writer.Write(output, std::move(buffers));
+			return true;
+		}
+
+		neb::CJsonObject TilesBackend::NodeToTile(const Node& node, const std::string& content, const std::string& childPrefix)
+		{
+			double geometricError = GeometricError(node);
+
+			neb::CJsonObject oJson;
+			oJson.Add("boundingVolume", BoundingVolumeToJson(node.bb));
+			oJson.Add("geometricError", geometricError);
+			oJson.Add("refine", "REPLACE");
+			if (!content.empty())
+			{
+				oJson.AddEmptySubObject("content");
+				oJson["content"].Add("uri", content);
+			}
+
+			// a child file of the same tile is linked with its own bounds, so that it is culled
+			// before its tileset is requested; other links reuse the volume of the node
+			if (!node.children.empty())
+			{
+				oJson.AddEmptySubArray("children");
+				for (const auto& child : node.children)
+				{
+					auto found = _fileBounds.find(child);
+					bool known = found != _fileBounds.end() && found->second.bb.valid();
+					neb::CJsonObject oChild;
+					oChild.Add("boundingVolume", BoundingVolumeToJson(known ? found->second.bb : node.bb));
+					oChild.Add("geometricError", known ? found->second.geometricError : geometricError);
+					oChild.AddEmptySubObject("content");
+					oChild["content"].Add("uri", childPrefix + child + ".json");
+					oJson["children"].Add(oChild);
+				}
+			}
+			return oJson;
+		}
+
+		neb::CJsonObject TilesBackend::BoundingVolumeToJson(const osg::BoundingBox& bb)
+		{
+			osg::Vec3d center(0, 0, 0);
+			osg::Vec3d half(0, 0, 0);
+			if (bb.valid())
+			{
+				center = bb.center();
+				half = (bb._max - bb._min) * 0.5;
+			}
+
+			neb::CJsonObject oJson;
+			oJson.AddEmptySubArray("box");
+			double box[12] = {
+				center.x(), center.y(), center.z(),
+				half.x(), 0, 0,
+				0, half.y(), 0,
+				0, 0, half.z() };
+			for (int i = 0; i < 12; ++i)
+			{
+				oJson["box"].Add(box[i]);
+			}
+			return oJson;
+		}
+
+		// 3mx shows a node while its projected diameter is below maxScreenDiameter pixels,
+		// 3d tiles refines when the projected error exceeds 16 pixels
+		double TilesBackend::GeometricError(const Node& node)
+		{
+			if (!node.bb.valid() || node.maxScreenDiameter >= 1e29)
+			{
+				return 0;
+			}
+			double diameter = (node.bb._max - node.bb._min).length();
+			if (node.maxScreenDiameter <= 0)
+			{
+				return diameter * 16;
+			}
+			return diameter * 16 / node.maxScreenDiameter;
+		}
+
+		// local to ECEF, column major
+		bool TilesBackend::RootTransform(double transform[16])
+		{
+			const osg::Vec3d& origin = _metadata.srsOrigin;
+			double lat = 0, lon = 0;
+			if (sscanf(_metadata.srs.c_str(), "ENU:%lf,%lf", &lat, &lon) == 2)
+			{
+				const double a = 6378137.0;
+				const double e2 = 6.69437999014e-3;
+				double phi = osg::DegreesToRadians(lat);
+				double lambda = osg::DegreesToRadians(lon);
+				double sinPhi = sin(phi), cosPhi = cos(phi);
+				double sinLambda = sin(lambda), cosLambda = cos(lambda);
+				double N = a / sqrt(1 - e2 * sinPhi * sinPhi);
+
+				osg::Vec3d east(-sinLambda, cosLambda, 0);
+				osg::Vec3d north(-sinPhi * cosLambda, -sinPhi * sinLambda, cosPhi);
+				osg::Vec3d up(cosPhi * cosLambda, cosPhi * sinLambda, sinPhi);
+				osg::Vec3d position(N * cosPhi * cosLambda, N * cosPhi * sinLambda, N * (1 - e2) * sinPhi);
+				position += east * origin.x() + north * origin.y() + up * origin.z();
+
+				double m[16] = {
+					east.x(), east.y(), east.z(), 0,
+					north.x(), north.y(), north.z(), 0,
+					up.x(), up.y(), up.z(), 0,
+					position.x(), position.y(), position.z(), 1 };
+				memcpy(transform, m, sizeof(m));
+				return true;
+			}
+
+			if (_metadata.srs != "EPSG:4978")
+			{
+				seed::log::DumpLog(seed::log::Warning, "SRS %s is not supported by 3D Tiles output, the tileset will not be georeferenced.", _metadata.srs.c_str());
+			}
+			if (origin == osg::Vec3d(0, 0, 0))
+			{
+				return false;
+			}
+			double m[16] = {
+				1, 0, 0, 0,
+				0, 1, 0, 0,
+				0, 0, 1, 0,
+				origin.x(), origin.y(), origin.z(), 1 };
+			memcpy(transform, m, sizeof(m));
+			return true;
+		}
+	}
+}
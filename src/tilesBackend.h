@@ -0,0 +1,66 @@
+#pragma once
+
+#include "outputBackend.h"
+#include "fileWriter.h"
+#include "CJsonObject.hpp"
+
+#include <map>
+#include <mutex>
+
+namespace seed
+{
+	namespace io
+	{
+		// Cesium 3D Tiles 1.0: tileset.json at the root, one external tileset and
+		// b3dm (batched glb) per input file, written to the storage of the output
+		class TilesBackend : public OutputBackend
+		{
+		public:
+			TilesBackend(const std::string& output, const std::shared_ptr<Storage>& storage, const EncodeOptions& options = EncodeOptions());
+
+			~TilesBackend() {}
+
+			const char* Name() const override { return "3dtiles"; }
+
+			bool Begin(const Metadata& metadata) override;
+			bool BeginTile(const std::string& tileName) override;
+			bool WriteFile(const std::string& tileName, const std::string& baseName, const std::vector<Node>& nodes,
+				const std::vector<Resource>& resourcesGeometry, const std::vector<Resource>& resourcesTexture) override;
+			bool EndTile(const std::string& tileName) override;
+			bool End(const std::vector<Node>& nodes, const std::vector<Resource>& resourcesGeometry, const std::vector<Resource>& resourcesTexture) override;
+
+		private:
+			bool GenerateB3dm(const Node& node, const std::vector<Resource>& resourcesGeometry, const std::vector<Resource>& resourcesTexture, const std::string& output);
+			bool GenerateTileset(neb::CJsonObject& root, double geometricError, const std::string& output);
+			bool GenerateFileTileset(const std::vector<Node>& nodes, const std::vector<std::string>& contents, const std::string& output);
+
+			neb::CJsonObject NodeToTile(const Node& node, const std::string& content, const std::string& childPrefix);
+			neb::CJsonObject BoundingVolumeToJson(const osg::BoundingBox& bb);
+			double GeometricError(const Node& node);
+			bool RootTransform(double transform[16]);
+
+		private:
+			std::string _output;	// for messages, paths are relative to the storage
+			EncodeOptions _options;
+			Metadata _metadata;
+			FileWriter _writer;
+
+			// The tileset of a file links its children files, whose bounds are only known once
+			// they are converted: the tilesets of a tile are written by EndTile.
+			struct PendingFile
+			{
+				std::string output;
+				std::vector<Node> nodes;				// without resources
+				std::vector<std::string> contents;		// b3dm of each node, "" if it has none
+			};
+			struct FileBounds
+			{
+				osg::BoundingBox bb;
+				double geometricError = 0;
+			};
+			std::mutex _pendingMutex;
+			std::map<std::string, PendingFile> _pendingFiles;	// by base name, of the current tile
+			std::map<std::string, FileBounds> _fileBounds;		// by base name, of the current tile
+		};
+	}
+}
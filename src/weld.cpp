@@ -0,0 +1,146 @@
+#include "weld.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace seed
+{
+	namespace io
+	{
+		// grids of the attributes compared with a tolerance
+		static const float NormalTolerance = 1e-3f;
+		static const float UVTolerance = 1e-5f;
+
+		static int64_t ExactKey(float value)
+		{
+			if (value == 0.0f)
+				value = 0.0f;	// -0 and +0 weld
+			uint32_t bits;
+			memcpy(&bits, &value, sizeof(bits));
+			return bits;
+		}
+
+		static int64_t GridKey(float value, float step)
+		{
+			return (int64_t)std::floor(value / step + 0.5f);
+		}
+
+		static uint64_t HashKey(const int64_t* key, size_t stride)
+		{
+			uint64_t h = 0xcbf29ce484222325ull;
+			for (size_t k = 0; k < stride; ++k)
+			{
+				h ^= (uint64_t)key[k];
+				h *= 0x100000001b3ull;
+				h ^= h >> 29;
+			}
+			return h;
+		}
+
+		void WeldMesh(Mesh& mesh, float tolerance)
+		{
+			size_t vertexCount = mesh.vertices.size() / 3;
+			if (vertexCount < 2 || mesh.indices.empty())
+				return;
+
+			bool hasNormals = mesh.normals.size() == vertexCount * 3;
+			bool hasUVs = mesh.uvs.size() == vertexCount * 2;
+			bool hasColors = mesh.colors.size() == vertexCount * 4;
+			size_t stride = 3 + (hasNormals ? 3 : 0) + (hasUVs ? 2 : 0) + (hasColors ? 1 : 0);
+
+			// one row of integer keys per vertex
+			std::vector<int64_t> keys(vertexCount * stride);
+			for (size_t i = 0; i < vertexCount; ++i)
+			{
+				int64_t* key = &keys[i * stride];
+				for (int c = 0; c < 3; ++c)
+					*key++ = tolerance > 0 ? GridKey(mesh.vertices[i * 3 + c], tolerance) : ExactKey(mesh.vertices[i * 3 + c]);
+				if (hasNormals)
+				{
+					for (int c = 0; c < 3; ++c)
+						*key++ = tolerance > 0 ? GridKey(mesh.normals[i * 3 + c], NormalTolerance) : ExactKey(mesh.normals[i * 3 + c]);
+				}
+				if (hasUVs)
+				{
+					for (int c = 0; c < 2; ++c)
+						*key++ = tolerance > 0 ? GridKey(mesh.uvs[i * 2 + c], UVTolerance) : ExactKey(mesh.uvs[i * 2 + c]);
+				}
+				if (hasColors)
+				{
+					uint32_t rgba;
+					memcpy(&rgba, &mesh.colors[i * 4], sizeof(rgba));
+					*key++ = rgba;
+				}
+			}
+
+			// flat open addressing table of vertex index + 1, at most half full
+			size_t capacity = 1;
+			while (capacity < vertexCount * 2)
+				capacity <<= 1;
+			std::vector<unsigned int> table(capacity, 0);
+			std::vector<unsigned int> remap(vertexCount);
+			unsigned int weldedCount = 0;
+			for (size_t i = 0; i < vertexCount; ++i)
+			{
+				const int64_t* key = &keys[i * stride];
+				size_t slot = HashKey(key, stride) & (capacity - 1);
+				while (true)
+				{
+					unsigned int entry = table[slot];
+					if (entry == 0)
+					{
+						// first vertex of its kind, moved down to its welded position
+						table[slot] = (unsigned int)i + 1;
+						remap[i] = weldedCount;
+						if (weldedCount != i)
+						{
+							memcpy(&mesh.vertices[weldedCount * 3], &mesh.vertices[i * 3], sizeof(float) * 3);
+							if (hasNormals)
+								memcpy(&mesh.normals[weldedCount * 3], &mesh.normals[i * 3], sizeof(float) * 3);
+							if (hasUVs)
+								memcpy(&mesh.uvs[weldedCount * 2], &mesh.uvs[i * 2], sizeof(float) * 2);
+							if (hasColors)
+								memcpy(&mesh.colors[weldedCount * 4], &mesh.colors[i * 4], 4);
+						}
+						++weldedCount;
+						break;
+					}
+					if (memcmp(&keys[(entry - 1) * stride], key, sizeof(int64_t) * stride) == 0)
+					{
+						remap[i] = remap[entry - 1];
+						break;
+					}
+					slot = (slot + 1) & (capacity - 1);
+				}
+			}
+
+			if (weldedCount == vertexCount)
+				return;
+
+			mesh.vertices.resize(weldedCount * 3);
+			if (hasNormals)
+				mesh.normals.resize(weldedCount * 3);
+			if (hasUVs)
+				mesh.uvs.resize(weldedCount * 2);
+			if (hasColors)
+				mesh.colors.resize(weldedCount * 4);
+
+			size_t kept = 0;
+			for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3)
+			{
+				if (mesh.indices[t] >= vertexCount || mesh.indices[t + 1] >= vertexCount || mesh.indices[t + 2] >= vertexCount)
+					continue;
+				unsigned int a = remap[mesh.indices[t]];
+				unsigned int b = remap[mesh.indices[t + 1]];
+				unsigned int c = remap[mesh.indices[t + 2]];
+				if (a == b || b == c || a == c)
+					continue;
+				mesh.indices[kept++] = a;
+				mesh.indices[kept++] = b;
+				mesh.indices[kept++] = c;
+			}
+			mesh.indices.resize(kept);
+		}
+	}
+}
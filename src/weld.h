@@ -0,0 +1,15 @@
+#pragma once
+
+#include "model.h"
+
+namespace seed
+{
+	namespace io
+	{
+		// Merge the vertices of a tri-mesh that have the same position, normal, uv and color,
+		// and rebuild the index buffer on the merged vertices. With tolerance 0 attributes must be
+		// bitwise equal; otherwise positions are snapped to a tolerance grid (normals and uvs to
+		// fixed finer grids) before comparing. Triangles that collapse are dropped.
+		void WeldMesh(Mesh& mesh, float tolerance = 0.0f);
+	}
+}